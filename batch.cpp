@@ -0,0 +1,122 @@
+// Batch mode, see batch.hpp.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "lander.hpp"
+#include "prefixcache.hpp"
+#include "threadpool.hpp"
+#include "stats.hpp"
+#include "input.hpp"
+#include "batch.hpp"
+
+namespace lander {
+
+bool parse_schedule(const char* p, const char* end, Schedule& schedule)
+{
+    schedule.clear();
+    for (;;)
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ',' || *p == '\r')) ++p;
+        if (p == end || *p == '#') return true;
+        double fr;
+        const char* next = parse_double(p, end, fr);
+        if (!next) return false;
+        schedule.push_back(fr);
+        p = next;
+    }
+}
+
+bool read_batch(FILE* in, std::vector<BatchEntry>& entries)
+{
+    std::string text;
+    char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) text.append(chunk, n);
+    if (ferror(in)) return false;
+
+    int line = 0;
+    for (size_t pos = 0; pos < text.size();)
+    {
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string::npos) eol = text.size();
+        ++line;
+        BatchEntry entry{ line, {} };
+        if (!parse_schedule(text.c_str() + pos, text.c_str() + eol, entry.schedule))
+            fprintf(stderr, "batch line %d: not a fuel rate schedule, skipped\n", line);
+        else if (!entry.schedule.empty())
+            entries.push_back(std::move(entry));
+        pos = eol + 1;
+    }
+    return true;
+}
+
+std::vector<LandingResult> run_batch(const std::vector<BatchEntry>& entries, const Options& opt, ThreadPool& pool,
+    size_t cache_bytes, CacheCounters* cache)
+{
+    std::vector<LandingResult> results(entries.size());
+    if (cache_bytes == 0)
+    {   // a landing takes microseconds, so hand out a few dozen at a time.
+        const simulate_fn land = simulator(opt.CalcMethod);
+        pool.parallel_for(entries.size(), 32, [&](size_t b, size_t e)
+        {
+            for (size_t i = b; i < e; ++i) results[i] = land(entries[i].schedule, opt);
+        });
+        return results;
+    }
+    // one cache per worker and one for the calling thread, which helps out.
+    std::vector<std::unique_ptr<PrefixCache>> caches;
+    for (unsigned i = 0; i <= pool.size(); ++i) caches.emplace_back(new PrefixCache(cache_bytes / (pool.size() + 1)));
+    pool.parallel_for(entries.size(), 32, [&](size_t b, size_t e)
+    {
+        PrefixCache& own = *caches[pool.worker_index()];
+        for (size_t i = b; i < e; ++i) results[i] = own.simulate(entries[i].schedule, opt);
+    });
+    if (cache) for (const auto& c : caches) *cache += c->counters();
+    return results;
+}
+
+void write_batch(FILE* out, const std::vector<BatchEntry>& entries, const std::vector<LandingResult>& results)
+{
+    // full precision, so results can be compared bit for bit to other runs.
+    fputs("line,time,impact_mph,fuel_left,landing,calc,fuel_out_time\n", out);
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const LandingResult& r = results[i];
+        fprintf(out, "%d,%.17g,%.17g,%.17g,%s,%s,%.17g\n", entries[i].line, r.T, r.impact_mph(), r.fuel,
+            landingclass_name(classify(r.impact_mph())), calcmethod_name(r.method), r.fuel_out_T);
+    }
+}
+
+int batch_main(const char* path, const Options& opt, unsigned nthreads, statsformat stats, size_t cache_bytes)
+{
+    FILE* in = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+    if (!in) { fprintf(stderr, "Cannot open batch file %s\n", path); return 1; }
+    std::vector<BatchEntry> entries;
+    const bool ok = read_batch(in, entries);
+    if (in != stdin) fclose(in);
+    if (!ok) { fprintf(stderr, "Cannot read batch file %s\n", path); return 1; }
+
+    ThreadPool pool(nthreads);
+    CacheCounters cache;
+    const auto results = run_batch(entries, opt, pool, cache_bytes, &cache);
+    write_batch(stdout, entries, results);
+    if (cache_bytes)
+        fprintf(stderr, "cache: %ld of %ld turns resumed (%.1f%%), %zu states cached, %ld evicted\n",
+            cache.resumed_turns, cache.turns, 100 * cache.hit_rate(), cache.states, cache.evictions);
+#ifdef LANDER_STATS
+    if (stats != STATS_OFF)
+    {
+        Stats total;
+        for (const LandingResult& r : results) total += r.stats;
+        write_stats(stderr, total, stats);
+    }
+#else
+    (void)stats;
+#endif
+    return 0;
+}
+
+}
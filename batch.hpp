@@ -0,0 +1,41 @@
+// Batch mode: land many fuel rate schedules from one file in parallel (--batch <file>).
+#pragma once
+#include <stdio.h>
+#include <vector>
+#include "lander.hpp"
+#include "stats.hpp"
+
+namespace lander {
+
+class ThreadPool;
+struct CacheCounters;
+
+struct BatchEntry {
+    int line;           // line number in the batch file, identifies the schedule in the results
+    Schedule schedule;
+};
+
+// Parse the fuel rates of one line into schedule. Returns false if the line holds anything else.
+bool parse_schedule(const char* p, const char* end, Schedule& schedule);
+
+// One schedule per line: fuel rates separated by blanks, tabs or commas.
+// '#' starts a comment, empty lines are skipped. Lines with something other than numbers
+// are reported on stderr and skipped. Returns false on a read error.
+bool read_batch(FILE* in, std::vector<BatchEntry>& entries);
+
+// simulate() every schedule, spread over the pool.
+// With cache_bytes > 0 every thread lands through a PrefixCache of its share of that budget,
+// their counters are added to cache (optional).
+std::vector<LandingResult> run_batch(const std::vector<BatchEntry>& entries, const Options& opt, ThreadPool& pool,
+    size_t cache_bytes = 0, CacheCounters* cache = nullptr);
+
+// One csv row per schedule, in the order of the batch file.
+void write_batch(FILE* out, const std::vector<BatchEntry>& entries, const std::vector<LandingResult>& results);
+
+// --batch front end, returns the exit code for main().
+// With stats (LANDER_STATS builds) the counters summed over all landings are written to stderr,
+// as is the hit rate with cache_bytes > 0 (--cache <MB>).
+int batch_main(const char* path, const Options& opt, unsigned nthreads, statsformat stats = STATS_OFF,
+    size_t cache_bytes = 0);
+
+}
@@ -1,5 +1,9 @@
 // https://people.math.sc.edu/Burkardt/cpp_src/brent/brent.html
 #pragma once
+#include <stddef.h>
+#include <math.h>
+#include <vector>
+#include <functional>
 #ifdef _DLL
 #ifdef BRENTLIB_EXPORT
   #ifdef _DLL
@@ -64,7 +68,784 @@ public:
 //double r8_sign ( double x );
 //void timestamp ( );
 GLOBAL double zero(double a, double b, double t, const std::function<double(double)>& f);
+
+// Iteration state of the reverse communication routines. Owned by the caller,
+// so any number of solves can be in flight, e.g. one per lander per thread.
+// Nothing needs to be initialized, the call with status 0 does that.
+struct zero_rc_state {
+   double c, d, e, fa, fb, fc, macheps, sa, sb;
+};
+struct local_min_rc_state {
+   double arg, c, d, e, eps, fu, fv, fw, fx, midpoint, p, q, r, tol, tol1, tol2, u, v, w, x;
+};
+GLOBAL void zero_rc ( double a, double b, double t, double &arg, int &status, double value, zero_rc_state& state );
+GLOBAL double local_min_rc ( double &a, double &b, int &status, double value, local_min_rc_state& state );
+// the same with a state per thread, one solve at a time on each thread.
 GLOBAL void zero_rc ( double a, double b, double t, double &arg, int &status, double value );
+GLOBAL double local_min_rc ( double &a, double &b, int &status, double value );
+
+// Lockstep driver for K independent zero_rc solves, root k in [a[k], b[k]] with tolerance t.
+// Each step gathers the abscissae requested by the unfinished solves and evaluates them in one call
+//    f(n, lanes, x, fx)   fx[j] = F_lanes[j](x[j]) for j < n,
+// so f can run a vectorized kernel over all of them. Solves leave the batch as they converge.
+// root[k] gets the zero, status[k] (optional) 0 on success or -1 if [a[k], b[k]] is no change of
+// sign interval, in which case root[k] is NaN.
+template <typename F>
+void zero_batch(size_t K, const double* a, const double* b, double t, F&& f, double* root, int* status = nullptr)
+{
+   std::vector<zero_rc_state> state(K);
+   std::vector<int> stat(K, 0);
+   std::vector<double> arg(K), x, fx;
+   std::vector<size_t> active;
+   active.reserve(K);
+   x.reserve(K);
+   fx.resize(K);
+   for (size_t k = 0; k < K; ++k)
+   {
+      zero_rc(a[k], b[k], t, arg[k], stat[k], 0.0, state[k]);      // startup, asks for f(a)
+      active.push_back(k);
+   }
+   while (!active.empty())
+   {
+      x.clear();
+      for (size_t k : active) x.push_back(arg[k]);
+      f(active.size(), active.data(), x.data(), fx.data());
+      size_t keep = 0;
+      for (size_t j = 0; j < active.size(); ++j)
+      {
+         const size_t k = active[j];
+         zero_rc(a[k], b[k], t, arg[k], stat[k], fx[j], state[k]);
+         if (stat[k] > 0) active[keep++] = k;
+         else root[k] = stat[k] == 0 ? arg[k] : NAN;
+      }
+      active.resize(keep);
+   }
+   if (status) for (size_t k = 0; k < K; ++k) status[k] = stat[k];
+}
+
+// ======================================================================
+// === Templates, header only.
+// === The objective F is called directly, not through std::function or the
+// === virtual func_base::operator(), so the compiler can inline it into the
+// === iteration. Any callable taking and returning double will do: a lambda,
+// === a functor (func_base derived ones included) or a plain function.
+// === The GLOBAL zero, glomin and local_min are instantiations of these.
+
+namespace detail {
+// R8_EPSILON and R8_MAX of brent.cpp
+inline double r8_epsilon() { return 2.220446049250313E-016; }
+inline double r8_max(double x, double y) { return y < x ? x : y; }
+}
+
+//****************************************************************************80
+
+template <typename F>
+double glomin(double a, double b, double c, double m, double e, double t,
+   F&& f, double& x)
+
+   //****************************************************************************80
+   //
+   //  Purpose:
+   //
+   //    GLOMIN seeks a global minimum of a function F(X) in an interval [A,B].
+   //
+   //  Discussion:
+   //
+   //    This function assumes that F(X) is twice continuously differentiable
+   //    over [A,B] and that F''(X) <= M for all X in [A,B].
+   //
+   //  Licensing:
+   //
+   //    This code is distributed under the GNU LGPL license.
+   //
+   //  Modified:
+   //
+   //    17 July 2011
+   //
+   //  Author:
+   //
+   //    Original FORTRAN77 version by Richard Brent.
+   //    C++ version by John Burkardt.
+   //
+   //  Reference:
+   //
+   //    Richard Brent,
+   //    Algorithms for Minimization Without Derivatives,
+   //    Dover, 2002,
+   //    ISBN: 0-486-41998-3,
+   //    LC: QA402.5.B74.
+   //
+   //  Parameters:
+   //
+   //    Input, double A, B, the endpoints of the interval.
+   //    It must be the case that A < B.
+   //
+   //    Input, double C, an initial guess for the global
+   //    minimizer.  If no good guess is known, C = A or B is acceptable.
+   //
+   //    Input, double M, the bound on the second derivative.
+   //
+   //    Input, double E, a positive tolerance, a bound for the
+   //    absolute error in the evaluation of F(X) for any X in [A,B].
+   //
+   //    Input, double T, a positive error tolerance.
+   //
+   //    Input, F&& F, a user-supplied callable whose
+   //    global minimum is being sought.  The input and output
+   //    of F() are of type double.
+   //
+   //    Output, double &X, the estimated value of the abscissa
+   //    for which F attains its global minimum value in [A,B].
+   //
+   //    Output, double GLOMIN, the value F(X).
+   //
+{
+   double a0;
+   double a2;
+   double a3;
+   double d0;
+   double d1;
+   double d2;
+   double h;
+   int k;
+   double m2;
+   double macheps;
+   double p;
+   double q;
+   double qs;
+   double r;
+   double s;
+   double sc;
+   double y;
+   double y0;
+   double y1;
+   double y2;
+   double y3;
+   double yb;
+   double z0;
+   double z1;
+   double z2;
+
+   a0 = b;
+   x = a0;
+   a2 = a;
+   y0 = f(b);
+   yb = y0;
+   y2 = f(a);
+   y = y2;
+
+   if (y0 < y)
+   {
+      y = y0;
+   }
+   else
+   {
+      x = a;
+   }
+
+   if (m <= 0.0 || b <= a)
+   {
+      return y;
+   }
+
+   macheps = detail::r8_epsilon();
+
+   m2 = 0.5 * (1.0 + 16.0 * macheps) * m;
+
+   if (c <= a || b <= c)
+   {
+      sc = 0.5 * (a + b);
+   }
+   else
+   {
+      sc = c;
+   }
+
+   y1 = f(sc);
+   k = 3;
+   d0 = a2 - sc;
+   h = 9.0 / 11.0;
+
+   if (y1 < y)
+   {
+      x = sc;
+      y = y1;
+   }
+   //
+   //  Loop.
+   //
+   for (; ; )
+   {
+      d1 = a2 - a0;
+      d2 = sc - a0;
+      z2 = b - a2;
+      z0 = y2 - y1;
+      z1 = y2 - y0;
+      r = d1 * d1 * z0 - d0 * d0 * z1;
+      p = r;
+      qs = 2.0 * (d0 * z1 - d1 * z0);
+      q = qs;
+
+      if (k < 1000000 || y2 <= y)
+      {
+         for (; ; )
+         {
+            if (q * (r * (yb - y2) + z2 * q * ((y2 - y) + t)) <
+               z2 * m2 * r * (z2 * q - r))
+            {
+               a3 = a2 + r / q;
+               y3 = f(a3);
+
+               if (y3 < y)
+               {
+                  x = a3;
+                  y = y3;
+               }
+            }
+            k = ((1611 * k) % 1048576);
+            q = 1.0;
+            r = (b - a) * 0.00001 * (double)(k);
+
+            if (z2 <= r)
+            {
+               break;
+            }
+         }
+      }
+      else
+      {
+         k = ((1611 * k) % 1048576);
+         q = 1.0;
+         r = (b - a) * 0.00001 * (double)(k);
+
+         while (r < z2)
+         {
+            if (q * (r * (yb - y2) + z2 * q * ((y2 - y) + t)) <
+               z2 * m2 * r * (z2 * q - r))
+            {
+               a3 = a2 + r / q;
+               y3 = f(a3);
+
+               if (y3 < y)
+               {
+                  x = a3;
+                  y = y3;
+               }
+            }
+            k = ((1611 * k) % 1048576);
+            q = 1.0;
+            r = (b - a) * 0.00001 * (double)(k);
+         }
+      }
+
+      r = m2 * d0 * d1 * d2;
+      s = sqrt(((y2 - y) + t) / m2);
+      h = 0.5 * (1.0 + h);
+      p = h * (p + 2.0 * r * s);
+      q = q + 0.5 * qs;
+      r = -0.5 * (d0 + (z0 + 2.01 * e) / (d0 * m2));
+
+      if (r < s || d0 < 0.0)
+      {
+         r = a2 + s;
+      }
+      else
+      {
+         r = a2 + r;
+      }
+
+      if (0.0 < p * q)
+      {
+         a3 = a2 + p / q;
+      }
+      else
+      {
+         a3 = r;
+      }
+
+      for (; ; )
+      {
+         a3 = detail::r8_max(a3, r);
+
+         if (b <= a3)
+         {
+            a3 = b;
+            y3 = yb;
+         }
+         else
+         {
+            y3 = f(a3);
+         }
+
+         if (y3 < y)
+         {
+            x = a3;
+            y = y3;
+         }
+
+         d0 = a3 - a2;
+
+         if (a3 <= r)
+         {
+            break;
+         }
+
+         p = 2.0 * (y2 - y3) / (m * d0);
+
+         if ((1.0 + 9.0 * macheps) * d0 <= fabs(p))
+         {
+            break;
+         }
+
+         if (0.5 * m2 * (d0 * d0 + p * p) <= (y2 - y) + (y3 - y) + 2.0 * t)
+         {
+            break;
+         }
+         a3 = 0.5 * (a2 + a3);
+         h = 0.9 * h;
+      }
+
+      if (b <= a3)
+      {
+         break;
+      }
+
+      a0 = sc;
+      sc = a2;
+      a2 = a3;
+      y0 = y1;
+      y1 = y2;
+      y2 = y3;
+   }
+
+   return y;
+}
+//****************************************************************************80
+
+template <typename F>
+double local_min(double a, double b, double t, F&& f,
+   double& x)
+
+   //****************************************************************************80
+   //
+   //  Purpose:
+   //
+   //    LOCAL_MIN seeks a local minimum of a function F(X) in an interval [A,B].
+   //
+   //  Discussion:
+   //
+   //    If the function F is defined on the interval (A,B), then local_min
+   //    finds an approximation X to the point at which F attatains its minimum
+   //    (or the appropriate limit point), and returns the value of F at X.
+   //
+   //    T and EPS define a tolerance TOL = EPS * abs ( X ) + T.
+   //    F is never evaluated at two points closer than TOL.  
+   //
+   //    If F is delta-unimodal for some delta less than TOL, the X approximates
+   //    the global minimum of F with an error less than 3*TOL.
+   //
+   //    If F is not delta-unimodal, then X may approximate a local, but 
+   //    perhaps non-global, minimum.
+   //
+   //    The method used is a combination of golden section search and
+   //    successive parabolic interpolation.  Convergence is never much slower
+   //    than that for a Fibonacci search.  If F has a continuous second
+   //    derivative which is positive at the minimum (which is not at A or
+   //    B), then, ignoring rounding errors, convergence is superlinear, and 
+   //    usually of the order of about 1.3247.
+   //
+   //  Licensing:
+   //
+   //    This code is distributed under the GNU LGPL license.
+   //
+   //  Modified:
+   //
+   //    17 July 2011
+   //
+   //  Author:
+   //
+   //    Original FORTRAN77 version by Richard Brent.
+   //    C++ version by John Burkardt.
+   //
+   //  Reference:
+   //
+   //    Richard Brent,
+   //    Algorithms for Minimization Without Derivatives,
+   //    Dover, 2002,
+   //    ISBN: 0-486-41998-3,
+   //    LC: QA402.5.B74.
+   //
+   //  Parameters:
+   //
+   //    Input, double A, B, the endpoints of the interval.
+   //
+   //    Input, double T, a positive absolute error tolerance.
+   //
+   //    Input, F&& F, a user-supplied callable whose
+   //    local minimum is being sought.  The input and output
+   //    of F() are of type double.
+   //
+   //    Output, double &X, the estimated value of an abscissa
+   //    for which F attains a local minimum value in [A,B].
+   //
+   //    Output, double LOCAL_MIN, the value F(X).
+   //
+{
+   double c;
+   double d = 0.0;
+   double e;
+   double eps;
+   double fu;
+   double fv;
+   double fw;
+   double fx;
+   double m;
+   double p;
+   double q;
+   double r;
+   double sa;
+   double sb;
+   double t2;
+   double tol;
+   double u;
+   double v;
+   double w;
+   //
+   //  C is the square of the inverse of the golden ratio.
+   //
+   c = 0.5 * (3.0 - sqrt(5.0));
+
+   eps = sqrt(detail::r8_epsilon());
+
+   sa = a;
+   sb = b;
+   x = sa + c * (b - a);
+   w = x;
+   v = w;
+   e = 0.0;
+   fx = f(x);
+   fw = fx;
+   fv = fw;
+
+   for (; ; )
+   {
+      m = 0.5 * (sa + sb);
+      tol = eps * fabs(x) + t;
+      t2 = 2.0 * tol;
+      //
+      //  Check the stopping criterion.
+      //
+      if (fabs(x - m) <= t2 - 0.5 * (sb - sa))
+      {
+         break;
+      }
+      //
+      //  Fit a parabola.
+      //
+      r = 0.0;
+      q = r;
+      p = q;
+
+      if (tol < fabs(e))
+      {
+         r = (x - w) * (fx - fv);
+         q = (x - v) * (fx - fw);
+         p = (x - v) * q - (x - w) * r;
+         q = 2.0 * (q - r);
+         if (0.0 < q)
+         {
+            p = -p;
+         }
+         q = fabs(q);
+         r = e;
+         e = d;
+      }
+
+      if (fabs(p) < fabs(0.5 * q * r) &&
+         q * (sa - x) < p &&
+         p < q * (sb - x))
+      {
+         //
+         //  Take the parabolic interpolation step.
+         //
+         d = p / q;
+         u = x + d;
+         //
+         //  F must not be evaluated too close to A or B.
+         //
+         if ((u - sa) < t2 || (sb - u) < t2)
+         {
+            if (x < m)
+            {
+               d = tol;
+            }
+            else
+            {
+               d = -tol;
+            }
+         }
+      }
+      //
+      //  A golden-section step.
+      //
+      else
+      {
+         if (x < m)
+         {
+            e = sb - x;
+         }
+         else
+         {
+            e = sa - x;
+         }
+         d = c * e;
+      }
+      //
+      //  F must not be evaluated too close to X.
+      //
+      if (tol <= fabs(d))
+      {
+         u = x + d;
+      }
+      else if (0.0 < d)
+      {
+         u = x + tol;
+      }
+      else
+      {
+         u = x - tol;
+      }
+
+      fu = f(u);
+      //
+      //  Update A, B, V, W, and X.
+      //
+      if (fu <= fx)
+      {
+         if (u < x)
+         {
+            sb = x;
+         }
+         else
+         {
+            sa = x;
+         }
+         v = w;
+         fv = fw;
+         w = x;
+         fw = fx;
+         x = u;
+         fx = fu;
+      }
+      else
+      {
+         if (u < x)
+         {
+            sa = u;
+         }
+         else
+         {
+            sb = u;
+         }
+
+         if (fu <= fw || w == x)
+         {
+            v = w;
+            fv = fw;
+            w = u;
+            fw = fu;
+         }
+         else if (fu <= fv || v == x || v == w)
+         {
+            v = u;
+            fv = fu;
+         }
+      }
+   }
+   return fx;
+}
+//****************************************************************************80
+
+template <typename F>
+double zero(double a, double b, double t, F&& f)
+
+//****************************************************************************80
+//
+//  Purpose:
+//
+//    ZERO seeks the root of a function F(X) in an interval [A,B].
+//
+//  Discussion:
+//
+//    The interval [A,B] must be a change of sign interval for F.
+//    That is, F(A) and F(B) must be of opposite signs.  Then
+//    assuming that F is continuous implies the existence of at least
+//    one value C between A and B for which F(C) = 0.
+//
+//    The location of the zero is determined to within an accuracy
+//    of 6 * MACHEPS * abs ( C ) + 2 * T.
+//
+//    Thanks to Thomas Secretin for pointing out a transcription error in the
+//    setting of the value of P, 11 February 2013.
+//
+//  Licensing:
+//
+//    This code is distributed under the GNU LGPL license.
+//
+//  Modified:
+//
+//    11 February 2013
+//
+//  Author:
+//
+//    Original FORTRAN77 version by Richard Brent.
+//    C++ version by John Burkardt.
+//
+//  Reference:
+//
+//    Richard Brent,
+//    Algorithms for Minimization Without Derivatives,
+//    Dover, 2002,
+//    ISBN: 0-486-41998-3,
+//    LC: QA402.5.B74.
+//
+//  Parameters:
+//
+//    Input, double A, B, the endpoints of the change of sign interval.
+//
+//    Input, double T, a positive error tolerance.
+//
+//    Input, F&& F, the name of a user-supplied callable
+//    whose zero is being sought.  The input and output
+//    of F() are of type double.
+//
+//    Output, double ZERO, the estimated value of a zero of
+//    the function F.
+//
+{
+   double c;
+   double d;
+   double e;
+   double fa;
+   double fb;
+   double fc;
+   double m;
+   double macheps;
+   double p;
+   double q;
+   double r;
+   double s;
+   double sa;
+   double sb;
+   double tol;
+   //
+   //  Make local copies of A and B.
+   //
+   sa = a;
+   sb = b;
+   fa = f(sa);
+   fb = f(sb);
+
+   c = sa;
+   fc = fa;
+   e = sb - sa;
+   d = e;
+
+   macheps = detail::r8_epsilon();
+
+   for (; ; )
+   {
+      if (fabs(fc) < fabs(fb))
+      {
+         sa = sb;
+         sb = c;
+         c = sa;
+         fa = fb;
+         fb = fc;
+         fc = fa;
+      }
+
+      tol = 2.0 * macheps * fabs(sb) + t;
+      m = 0.5 * (c - sb);
+
+      if (fabs(m) <= tol || fb == 0.0)
+      {
+         break;
+      }
+
+      if (fabs(e) < tol || fabs(fa) <= fabs(fb))
+      {
+         e = m;
+         d = e;
+      }
+      else
+      {
+         s = fb / fa;
+
+         if (sa == c)
+         {
+            p = 2.0 * m * s;
+            q = 1.0 - s;
+         }
+         else
+         {
+            q = fa / fc;
+            r = fb / fc;
+            p = s * (2.0 * m * q * (q - r) - (sb - sa) * (r - 1.0));
+            q = (q - 1.0) * (r - 1.0) * (s - 1.0);
+         }
+
+         if (0.0 < p)
+         {
+            q = -q;
+         }
+         else
+         {
+            p = -p;
+         }
+
+         s = e;
+         e = d;
+
+         if (2.0 * p < 3.0 * m * q - fabs(tol * q) &&
+            p < fabs(0.5 * s * q))
+         {
+            d = p / q;
+         }
+         else
+         {
+            e = m;
+            d = e;
+         }
+      }
+      sa = sb;
+      fa = fb;
+
+      if (tol < fabs(d))
+      {
+         sb = sb + d;
+      }
+      else if (0.0 < m)
+      {
+         sb = sb + tol;
+      }
+      else
+      {
+         sb = sb - tol;
+      }
+
+      fb = f(sb);
+
+      if ((0.0 < fb && 0.0 < fc) || (fb <= 0.0 && fc <= 0.0))
+      {
+         c = sa;
+         fc = fa;
+         e = sb - sa;
+         d = e;
+      }
+   }
+   return sb;
+}
 
 // === simple wrapper functions
 // === for convenience and/or compatibility
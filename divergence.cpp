@@ -0,0 +1,139 @@
+// Cross method comparison, see divergence.hpp.
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <utility>
+#include <vector>
+#include "lander.hpp"
+#include "threadpool.hpp"
+#include "batch.hpp"
+#include "divergence.hpp"
+
+namespace lander {
+
+Divergence compare_methods(const Schedule& schedule, const Options& opt, bool keep_turns)
+{
+    static const play_turn_fn engine[3] = { turn_engine(ORIGINAL), turn_engine(BUGFIXED), turn_engine(EXACT) };
+    Divergence d;
+    LanderState L[3];
+    bool flying[3] = { true, true, true };
+    for (int m = 0; m < 3; ++m) d.result[m].method = (calcmethod)m;
+    size_t next = 0;
+    double fr = 0;
+    for (int turn = 1; flying[0] || flying[1] || flying[2]; ++turn)
+    {   // prompt_for_k once for all three, as simulate() does.
+        while (next < schedule.size())
+            if (valid_fuel_rate(schedule[next++])) { fr = schedule[next - 1]; break; }
+        bool done[3] = { false, false, false };     // flew this turn and did not land
+        for (int m = 0; m < 3; ++m)
+        {
+            if (!flying[m]) continue;
+            LandingResult& r = d.result[m];
+            ++r.turns;
+            const turnresult res = (L[m].*engine[m])(fr, opt, nullptr);
+            if (res == TURN_DONE) { done[m] = true; continue; }
+            if (res == FUEL_OUT)
+            {
+                r.fuel_out_T = L[m].T;
+                L[m].fall_without_fuel();
+            }
+            flying[m] = false;
+            r.T = L[m].T;
+            r.V = L[m].V;
+            r.fuel = L[m].fuel();
+        }
+        for (int i = 0; i < 3; ++i)
+            for (int j = i + 1; j < 3; ++j)
+                if (done[i] && done[j] && 3600 * fabs(L[i].V - L[j].V) > d.max_mph)
+                {
+                    d.max_mph = 3600 * fabs(L[i].V - L[j].V);
+                    d.max_turn = turn;
+                }
+        if (keep_turns)
+        {
+            MethodsTurn t;
+            for (int m = 0; m < 3; ++m) { t.A[m] = L[m].A; t.V[m] = L[m].V; t.M[m] = L[m].M; t.TF[m] = L[m].TF; }
+            d.turns.push_back(t);
+        }
+    }
+    // impact velocities, at the turn of the last touchdown.
+    for (int i = 0; i < 3; ++i)
+        for (int j = i + 1; j < 3; ++j)
+            if (fabs(d.result[i].impact_mph() - d.result[j].impact_mph()) > d.max_mph)
+            {
+                d.max_mph = fabs(d.result[i].impact_mph() - d.result[j].impact_mph());
+                d.max_turn = d.result[i].turns > d.result[j].turns ? d.result[i].turns : d.result[j].turns;
+            }
+    return d;
+}
+
+std::vector<Divergence> run_compare(const std::vector<BatchEntry>& entries, const Options& opt, ThreadPool& pool,
+    double threshold, bool keep_turns)
+{   // blocks of a few dozen landings, each keeping only its divergent ones: millions of schedules
+    // mostly cost their input.
+    const size_t grain = 32, nblocks = (entries.size() + grain - 1) / grain;
+    std::vector<std::vector<Divergence>> blocks(nblocks);
+    pool.parallel_for(nblocks, 1, [&](size_t b, size_t e)
+    {
+        for (size_t k = b; k < e; ++k)
+            for (size_t i = k * grain; i < entries.size() && i < (k + 1) * grain; ++i)
+            {
+                Divergence d = compare_methods(entries[i].schedule, opt, keep_turns);
+                if (!(d.max_mph > threshold)) continue;
+                d.line = entries[i].line;
+                blocks[k].push_back(std::move(d));
+            }
+    });
+    std::vector<Divergence> divergences;
+    for (auto& block : blocks)
+        for (auto& d : block) divergences.push_back(std::move(d));
+    return divergences;
+}
+
+void write_compare(FILE* out, const std::vector<Divergence>& divergences, bool turns)
+{
+    static const char* names[3] = { "original", "bugfixed", "exact" };
+    if (turns)
+    {   // long format: a row per method, differences to ORIGINAL in feet, mph, lbs and seconds.
+        fputs("line,turn,calc,altitude_ft,speed_mph,mass_lbs,tf,d_altitude_ft,d_speed_mph,d_mass_lbs,d_tf,on_the_moon\n", out);
+        for (const Divergence& d : divergences)
+            for (size_t t = 0; t < d.turns.size(); ++t)
+            {
+                const MethodsTurn& s = d.turns[t];
+                for (int m = 0; m < 3; ++m)
+                    fprintf(out, "%d,%zu,%s,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%d\n", d.line, t + 1, names[m],
+                        5280 * s.A[m], 3600 * s.V[m], s.M[m], s.TF[m], 5280 * (s.A[m] - s.A[0]), 3600 * (s.V[m] - s.V[0]),
+                        s.M[m] - s.M[0], s.TF[m] - s.TF[0], (int)t + 1 >= d.result[m].turns);
+            }
+        return;
+    }
+    fputs("line,divergence_mph,at_turn", out);
+    for (int m = 0; m < 3; ++m) fprintf(out, ",turns_%s,time_%s,impact_mph_%s", names[m], names[m], names[m]);
+    fputc('\n', out);
+    for (const Divergence& d : divergences)
+    {
+        fprintf(out, "%d,%.17g,%d", d.line, d.max_mph, d.max_turn);
+        for (int m = 0; m < 3; ++m)
+            fprintf(out, ",%d,%.17g,%.17g", d.result[m].turns, d.result[m].T, d.result[m].impact_mph());
+        fputc('\n', out);
+    }
+}
+
+int compare_main(const char* path, const Options& opt, unsigned nthreads, double threshold, bool turns)
+{
+    FILE* in = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+    if (!in) { fprintf(stderr, "Cannot open batch file %s\n", path); return 1; }
+    std::vector<BatchEntry> entries;
+    const bool ok = read_batch(in, entries);
+    if (in != stdin) fclose(in);
+    if (!ok) { fprintf(stderr, "Cannot read batch file %s\n", path); return 1; }
+
+    ThreadPool pool(nthreads);
+    const auto divergences = run_compare(entries, opt, pool, threshold, turns);
+    write_compare(stdout, divergences, turns);
+    fprintf(stderr, "compare: %zu of %zu schedules diverge more than %g mph\n", divergences.size(), entries.size(),
+        threshold);
+    return 0;
+}
+
+}
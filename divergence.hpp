@@ -0,0 +1,43 @@
+// Cross method comparison (--compare <file>): every schedule of a batch file is flown by ORIGINAL,
+// BUGFIXED and EXACT in lockstep, turn by turn on the same parsed fuel rates, instead of diffing
+// three game outputs by hand. Only schedules whose landings diverge more than a threshold are written.
+#pragma once
+#include <stdio.h>
+#include <vector>
+#include "lander.hpp"
+#include "batch.hpp"
+
+namespace lander {
+
+class ThreadPool;
+
+// the landers at the end of a turn, indexed by calcmethod. A method that is on the moon keeps
+// its landed state in the later turns.
+struct MethodsTurn {
+    double A[3], V[3], M[3], TF[3];
+};
+
+struct Divergence {
+    int line{ 0 };              // line number in the batch file
+    double max_mph{ 0 };        // largest speed difference of two methods after a turn both flew, or at impact
+    int max_turn{ 0 };          // turn of max_mph, 0 if none
+    LandingResult result[3];    // per method: turns is the turn in which touchdown was detected
+    std::vector<MethodsTurn> turns; // per turn, when asked for
+};
+
+// fly a schedule with all three methods at once. opt.CalcMethod is not used.
+Divergence compare_methods(const Schedule& schedule, const Options& opt, bool keep_turns);
+
+// compare_methods() for every schedule, spread over the pool. Returns the ones with max_mph > threshold,
+// in the order of entries.
+std::vector<Divergence> run_compare(const std::vector<BatchEntry>& entries, const Options& opt, ThreadPool& pool,
+    double threshold, bool keep_turns);
+
+// one csv row per schedule: the divergence and the touchdown turn, time and impact velocity per method.
+// With turns (--turns), a row per turn and method instead, with the differences to ORIGINAL.
+void write_compare(FILE* out, const std::vector<Divergence>& divergences, bool turns);
+
+// --compare front end, returns the exit code for main().
+int compare_main(const char* path, const Options& opt, unsigned nthreads, double threshold, bool turns);
+
+}
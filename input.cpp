@@ -0,0 +1,61 @@
+// Line input, see input.hpp.
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <charconv>
+#include <system_error>
+#include "input.hpp"
+
+namespace lander {
+
+const char* LineReader::next(size_t* length)
+{
+    // Zie https ://stackoverflow.com/questions/58670828/is-there-a-way-to-rewind-stdin-in-c. stdin niet seekable.
+    if (!in || feof(in)) return nullptr;
+    size_t n = 0;
+    for (;;)
+    {   // fgets in the free part of the buffer, doubled while a line does not fit: nothing is split.
+        if (!fgets(buf.data() + n, (int)(buf.size() - n), in)) { if (n == 0) return nullptr; break; }
+        n += strlen(buf.data() + n);
+        if (n > 0 && buf[n - 1] == '\n') break;
+        if (n + 1 < buf.size()) break;      // end of input without a line end
+        buf.resize(2 * buf.size());
+    }
+    while (n > 0 && isspace((unsigned char)buf[n - 1])) --n;
+    buf[n] = 0;
+    if (length) *length = n;
+    return buf.data();
+}
+
+bool LineReader::at_end()
+{
+    if (!in) return true;
+    const int c = getc(in);
+    if (c == EOF) return true;
+    ungetc(c, in);
+    return false;
+}
+
+const char* parse_double(const char* p, const char* end, double& value)
+{
+    while (p < end && isspace((unsigned char)*p)) ++p;
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) negative = *p++ == '-';
+    if (p < end && (*p == '+' || *p == '-')) return nullptr;   // from_chars would take a second minus
+    const bool hex = end - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X');    // as sscanf reads it
+    const std::from_chars_result r = hex ? std::from_chars(p + 2, end, value, std::chars_format::hex)
+        : std::from_chars(p, end, value);
+    if (r.ec == std::errc::invalid_argument) return nullptr;
+    if (r.ec == std::errc::result_out_of_range)
+    {   // from_chars leaves value alone, strtod gives the infinity or the underflow sscanf would.
+        std::vector<char> text(start, r.ptr);
+        text.push_back(0);
+        value = strtod(text.data(), nullptr);
+        return r.ptr;
+    }
+    if (negative) value = -value;
+    return r.ptr;
+}
+}
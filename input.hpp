@@ -0,0 +1,30 @@
+// Line input without an allocation per line: the game reads its fuel rates and answers through one
+// LineReader, whose buffer grows to the longest line seen and is reused for all of them.
+// Numbers are parsed with std::from_chars instead of sscanf.
+#pragma once
+#include <stdio.h>
+#include <stddef.h>
+#include <vector>
+
+namespace lander {
+
+class LineReader {
+public:
+    explicit LineReader(FILE* in) : in(in), buf(256) {}
+    // the next line, trailing white space (and the line end) removed, or nullptr at the end of the input.
+    // Lines of any length are read whole. The text is valid until the next call.
+    const char* next(size_t* length = nullptr);
+    // true if no more input follows, looking ahead one character.
+    bool at_end();
+
+private:
+    FILE* in;
+    std::vector<char> buf;
+};
+
+// The number at the start of [p, end), as sscanf("%lf") reads it: leading white space and a + sign
+// are skipped, anything after the number is ignored. Returns the end of the number, or nullptr if
+// there is none.
+const char* parse_double(const char* p, const char* end, double& value);
+
+}
@@ -0,0 +1,458 @@
+// Lander physics and turn engine, moved out of main() in lunarlander.cpp.
+// See there for the FOCAL source referred to by the line numbers (03.10 etc) and the history.
+#include <stdio.h>
+#include <math.h>
+#include <cmath>
+#include <array>
+#include <vector>
+#include <functional>
+#include "brent.hpp"
+#include "simd.hpp"
+#include "stats.hpp"
+#include "lander.hpp"
+
+namespace lander {
+
+// quadratic is a robust quadratic solver to find out whether numerical issues occur.
+bool quadratic(std::array<double, 2>& roots, double a, double b, double c)
+{   // https://en.wikipedia.org/wiki/Quadratic_formula#Square_root_in_the_denominator and note 22
+    // todo: complete using complex numbers. See commented lines, also at bottom of lunarlander.cpp.
+    auto sgn = [](const double x) {return x > 0 ? 1 : (x < 0 ? -1 : 0); };
+    if (a == 0) return false; const double b1 = b / a, c1 = c / a;
+    if (b == 0)
+    {   // ascending order. Used to take -roots[0] from the old contents of roots, which are uninitialized
+        // when the 07.10 loop is entered exactly at the lowest point (V == 0).
+        if (c1 > 0) return false;
+        const double r = sqrt(-c1);
+        roots = { -r, r };
+        return true;
+    }
+    if (c == 0) { roots = { -b1, 0 }; return true; }
+    double y1 = 0, y2 = 0;
+    const double c1abs = fabs(c1), scale = sqrt(c1abs) * sgn(b1), beta = b1 / (2 * scale), sc = sgn(c1);
+    // if (isreal([b1,c1])
+    {
+        if (sc == -1) { y1 = beta + sqrt(beta * beta + 1); y2 = -1 / y1; }
+        else if (beta >= 1)
+        { y1 = beta + sqrt((beta + 1) * (beta - 1)); y2 = 1 / y1; }
+        else return false;  // alleen complexe oplossingen.
+        //else
+        //{   // imaginair, zie gebruik j in complex.
+        //    const auto im = sqrt((beta + 1) * (1 - beta));
+        //    y1 = beta + j * im; y2 = beta - j * im;
+        //}
+    }
+    //else
+    //{   // with complex coefficients
+    //    scale = sgn(b1) * (sqrt(abs(c1)));
+    //    beta = abs(b1) / (2 * sqrt(abs(c1)));
+    //    f = sqrt(sgn(c1)) / sgn(b1);
+    //    gamma = sqrt((beta - f) * (beta + f));
+    //    y1 = beta + sign(real(gamma)) * gamma;
+    //    y2 = f ^ 2 / y1;
+    //}
+    roots = { -y1 * scale, -y2 * scale };
+    if (roots[0] > roots[1]) std::swap(roots[0], roots[1]);
+    return true;
+}
+
+// The tests of method are on a template parameter, each instantiation keeps only its own branches.
+template <calcmethod method>
+turnresult LanderState::play_turn(double fr, const Options& opt, TurnObserver* observer)
+{
+    FR = fr;
+    TimeRemain = 10;
+
+//turn_loop:
+    for (int il31 = 0;;++il31) // 03.10 in original FOCAL code
+    {
+        if (fuel() < .001) return FUEL_OUT;
+        if (TimeRemain < .001) return TURN_DONE;
+        // Additional output coming in well when having a flyoff or, contrarily, a landing when close to ground.
+        if (il31 && observer) observer->substep(*this);
+        TF = TimeRemain;
+        if (TF * FR > fuel()) TF = fuel() / FR;
+
+        apply_thrust<method>();
+
+        if (EndAlt <= 0)
+            goto loop_until_on_the_moon;
+
+        if (V > 0 && EndSpeed < 0)
+        {   // can only get here with power (FR) during the landing turn resulting in negative acceleration.
+            for (int il81 = 0;;++il81) // 08.10 in original FOCAL code
+            {
+                LANDER_COUNT(lowest_point_loops);
+                // FOCAL-to-C gotcha: In FOCAL, multiplication has a higher // precedence than division.
+                // In C, they have the same precedence and are evaluated left-to-right.
+                // So the original FOCAL subexpression `M * G / SpecThrust * FR` can't be copied as-is
+                // into C: `SpecThrust * FR` has to be parenthesized to get the same result.
+
+                // TF becomes time to zero speed -> time to lowest point given the motion direction reversal.
+                // you might try with the simplest estimate of TF for V == 0
+                // const auto acc = G - SpecThrust * FR / M;
+                // TF = -V / acc;    // which really comes out too high, overshoot, no obvious iteration available.
+                const double X = 0.5 * (1 - M * G / (SpecThrust * FR));
+#             ifdef _DEBUG
+                // precalculate TF according to the old formula for comparison to bugfix and other attempts
+                // You may want to leave out the addition of 0.05 sec, or apply it also in the bugfix.
+                TF = M * V / (SpecThrust * FR * (X + sqrt(X * X + V / SpecThrust))) + 0.05;
+#             else
+                if (method == ORIGINAL) TF = M * V / (SpecThrust * FR * (X + sqrt(X * X + V / SpecThrust))) + 0.05;
+#             endif
+                if (method == BUGFIXED)   // if modern, overwrite TF with corrected formula
+                {
+#                 ifdef _DEBUG
+                    // try other solution. Didn't work sofar, consider deprecated.
+                    TF = M * V / (SpecThrust * FR * (X - sqrt(X * X + 0.5 * V / SpecThrust)));
+#                 endif
+                    TF = M * V / (SpecThrust * FR * (X + sqrt(X * X + 0.5 * V / SpecThrust)));
+                }
+                else if (method == EXACT)
+                {   // solve getspeed(TF) == 0 within the time and fuel left. 3rd parameter is tolerance.
+                    double tmax = TimeRemain;
+                    if (tmax * FR > fuel()) tmax = fuel() / FR;
+                    int evaluations;
+                    TF = lowest_point_time(tmax, 1e-9, &evaluations);
+                    if (observer) observer->lowest_point_solved(*this, evaluations);
+                }
+
+                apply_thrust<method>();
+                // choose between original <= 0 or <= small value which may lead to a good landing instead of an flyoff.
+                if (EndAlt <= opt.maxdropheightft / 5280.)
+                {   // a perfect landing to be expected by turning of the engine at (very) low EndAlt.
+                    // This also relieves small inaccuracies in the TF calculation.
+                    update_lander_state();
+                    if (!il31 && observer) observer->lowest_point(*this);
+                    if (EndAlt >= 0)     // but smaller than or equal to maxdropheight
+                    {
+                        // loop_until_on_the_moon may fail to converge (really a marginal fly-off).
+                        TF = sqrt(2 * EndAlt / G);
+                        V = EndSpeed = TF * G;
+                        A = EndAlt = 0;
+                        T += TF;
+                        return ON_THE_MOON;
+                    }
+                    goto loop_until_on_the_moon; // lowest point under surface, find conditions when hitting ground.
+                }
+                update_lander_state();
+                // this condition is confused. May be the EndSpeed test should be done before update_lander_state()
+                // The EndSpeed and V comparisons are separate in the original code 8.30 (J and V).
+                //if (EndSpeed > 0 || V <= 0) goto turn_loop;     // V is set equal to EndSpeed in update_lander_state() ?!!
+                //if (EndSpeed > 0 || V <= 0) break;     // to continue the 3.10 loop, with loopcounter increased, not reset.
+                // if time has not run out, we want to repeat the search for negative altitude rather than repeating apply_thrust()
+                if (TimeRemain < 0.001 || V <= 0) break;  // force reading a new input if time has run out and apply_thrust() anyway.
+            }
+            continue;       // avoids update_lander_state() (again). Used to be goto turn_loop, now loop with counter.
+        }
+        update_lander_state();
+    }
+    // The way here appears to be: make an estimate without mass change (apply_thrust), then apply_thrust and
+    // hopefully not keep undershooting the surface. The equation is 0.5Gt2 + Vt = altitude (to be lost),
+    // Some have mentioned a possible numerical problem (catastrophic cancellation).
+    // I've added a robust quadratic solver, after which I cannot yet conclude to any such problem,
+    // but given the sometimes very low and close values, it is certainly possible.
+    // See https://en.wikipedia.org/wiki/Quadratic_formula#Square_root_in_the_denominator and note 22.
+    // A potential improvement is to check whether start or finish altitude of the turn is closer to zero
+    // to minimize the approximation effort, but it does not appear needed.
+loop_until_on_the_moon: // 07.10 in original FOCAL code
+    while (TF >= .005)
+    {   // calculate time from level zero to underground (A), reduce speed (marginal), update (landing)time, mass.
+        LANDER_COUNT(moon_loops);
+        std::array<double, 2> roots;
+        // TF should be pretty much equal to 5 or 6 digits or more in various way of calculating it.
+        // original formula, ok and still effectively used after precalculating acceleration and discriminant.
+        // TF = 2 * A / (V + sqrt(V * V + 2 * A * (G - SpecThrust * FR / M)));
+        const auto acc = G - SpecThrust * FR / M, disc = sqrt(V * V + 2 * A * acc);
+        TF = (disc - V) / acc;  // usual formula. See whether numerator and denominator root choice may differ explaining choice.
+#     ifdef _DEBUG
+        const auto tf = 2 * A / (disc + V);     // equivalent to commented original formula
+        if (tf != TF && fabs(tf - TF) > 1e-9) fprintf(stderr, "%.10lf vs %.10lf\n", tf, TF);
+#     endif
+        TF = 2 * A / (disc + V); // discriminant in denominator. This is expected to be consistently right.
+        // If we calculate undershoot correction, A should be positive -> negative in quadratic equation (sidechange).
+        if (method == EXACT)
+        {
+            // V == 0 (b == 0): the 08.10 loop left the lander exactly at its lowest point, on or under the
+            // surface, where it touches down at zero speed; its roots are the way back up and down.
+            if (V == 0) TF = 0;
+            else if (quadratic(roots, 0.5 * acc, V, -A))     // return false in case of no real root(s)
+                TF = roots[roots[0] < 0];
+            else LANDER_COUNT(quadratic_fallbacks);
+        }
+        if (TF > 0) apply_thrust<method>();
+        else if (TF < 0) { EndSpeed += TF * acc; EndAlt = 0; TF = 0; }  // not expected.
+        update_lander_state();
+    }
+    return ON_THE_MOON;
+}
+
+template turnresult LanderState::play_turn<ORIGINAL>(double, const Options&, TurnObserver*);
+template turnresult LanderState::play_turn<BUGFIXED>(double, const Options&, TurnObserver*);
+template turnresult LanderState::play_turn<EXACT>(double, const Options&, TurnObserver*);
+
+turnresult LanderState::play_turn(double fr, const Options& opt, TurnObserver* observer)
+{
+    return (this->*turn_engine(opt.CalcMethod))(fr, opt, observer);
+}
+
+double LanderState::lowest_point_time(double tmax, double tol, int* evaluations) const
+{
+    int n = 1;
+    double t = tmax;
+    if (V > 0 && getspeed(tmax) <= 0)
+    {   // getspeed() is concave (the acceleration G - SpecThrust * FR / (M - FR * t) keeps falling),
+        // so started right of the zero the iteration comes down to it from the right.
+        double lo = 0, hi = tmax;
+        const double acc = G - SpecThrust * FR / M;
+        t = acc < 0 && -V / acc < hi ? -V / acc : hi;   // the estimate at constant mass is late, as wanted.
+        for (;;)
+        {
+            if (!(lo < t && t <= hi) || n > 20)
+            {   // step left the bracket: let brent finish on it.
+                t = brent::zero(lo, hi, tol, [this, &n](double x) { ++n; LANDER_COUNT(zero_evaluations); return getspeed(x); });
+                break;
+            }
+            const double f = getspeed(t);
+            ++n;
+            if (f == 0) break;
+            if (f > 0) lo = t; else hi = t;
+            const double m = M - FR * t, f1 = G - SpecThrust * FR / m, f2 = -SpecThrust * FR * FR / (m * m);
+            const double dt = 2 * f * f1 / (2 * f1 * f1 - f * f2);
+            t -= dt;
+            if (fabs(dt) <= tol)
+            {
+                t = t < lo ? lo : t > hi ? hi : t;
+                break;
+            }
+        }
+    }
+    LANDER_ADD(solver_evaluations, n);
+    if (evaluations) *evaluations = n;
+    return t;
+}
+
+// Subroutine at line 04.40 in original FOCAL code
+void LanderState::fall_without_fuel()
+{
+    TF = (sqrt(V * V + 2 * A * G) - V) / G;
+    V += G * TF;
+    T += TF;
+}
+
+// Subroutine at line 06.10 in original FOCAL code
+void LanderState::update_lander_state()
+{
+    LANDER_COUNT(update_lander_state);
+    T += TF;
+    TimeRemain -= TF;
+    M -= TF * FR;
+    A = EndAlt;
+    V = EndSpeed;
+}
+
+// Subroutine at line 09.10 in original FOCAL code
+// Used to compute both the exact and the Taylor results and pick one; now each method computes its own.
+// EXACT takes log1p(-Q) rather than log(1 - Q): no cancellation for small Q, and the same function as the batched physics.
+template <calcmethod method>
+void LanderState::apply_thrust()
+{
+    LANDER_COUNT(apply_thrust);
+    const double Q = TF * FR / M;
+    if (method == EXACT)
+    {
+        EndSpeed = V + G * TF + SpecThrust * simd::log1p(-Q);   // exact, log(1 - Q)
+        EndAlt = A - G * TF * TF / 2 - V * TF;
+        if (Q > 0)
+        {
+            const auto a = FR / M;
+            // a bit of simpson to integrate to distance (altitude) increase.
+            //auto lfunc = [a](const double t) { return log(1 - a * t); };
+            //const auto y = simpson_rule<double, decltype(lfunc)>(0., TF, 10, lfunc);
+            const auto z = (TF - 1 / a) * simd::log1p(-Q) - TF;
+            EndAlt -= SpecThrust * z;       // exact.
+        }
+        return;
+    }
+    const double Q_2 = Q * Q, Q_3 = Q_2 * Q, Q_4 = Q_3 * Q, Q_5 = Q_4 * Q;
+    // Using Taylor expansion, NB deltax is negative -> terms get the same sign, no sign altercation:
+    EndSpeed = V + G * TF + SpecThrust * (-Q - Q_2 / 2 - Q_3 / 3 - Q_4 / 4 - Q_5 / 5);
+    // Taylor expansion integrated (t = 0 to TF), sum dA for gravity, starting speed and engine.
+    EndAlt = A - G * TF * TF / 2 - V * TF + SpecThrust * TF * (Q / 2 + Q_2 / 6 + Q_3 / 12 + Q_4 / 20 + Q_5 / 30);
+}
+
+template void LanderState::apply_thrust<ORIGINAL>();
+template void LanderState::apply_thrust<BUGFIXED>();
+template void LanderState::apply_thrust<EXACT>();
+
+int LanderState::apply_thrust_adaptive(double tol)
+{
+    const double Q = TF * FR / M;
+    int n = Q < 1 ? 1 : max_taylor_order + 1;
+    // Q^n against taylor_error_bound(), without the division.
+    for (double p = Q; n <= max_taylor_order && p > tol * (n + 1) * (1 - Q); p *= Q) ++n;
+    switch (n)
+    {
+    case 1: apply_thrust_taylor<1>(); break;
+    case 2: apply_thrust_taylor<2>(); break;
+    case 3: apply_thrust_taylor<3>(); break;
+    case 4: apply_thrust_taylor<4>(); break;
+    case 5: apply_thrust_taylor<5>(); break;
+    case 6: apply_thrust_taylor<6>(); break;
+    case 7: apply_thrust_taylor<7>(); break;
+    case 8: apply_thrust_taylor<8>(); break;
+    case 9: apply_thrust_taylor<9>(); break;
+    case 10: apply_thrust_taylor<10>(); break;
+    case 11: apply_thrust_taylor<11>(); break;
+    case 12: apply_thrust_taylor<12>(); break;
+    default: apply_thrust<EXACT>(); return 0;
+    }
+    return n;
+}
+
+void LanderState::apply_thrust(calcmethod method)
+{
+    switch (method)
+    {
+    case EXACT: apply_thrust<EXACT>(); break;
+    case BUGFIXED: apply_thrust<BUGFIXED>(); break;
+    default: apply_thrust<ORIGINAL>(); break;
+    }
+}
+
+landingclass classify(double mph)
+{
+    if (mph <= 1) return PERFECT;
+    else if (mph <= 10) return GOOD;
+    else if (mph <= 22) return POOR;
+    else if (mph <= 40) return DAMAGE;
+    else if (mph <= 60) return CRASH;
+    return NO_SURVIVORS;
+}
+
+const char* landingclass_name(landingclass c)
+{
+    static const char* names[] = { "perfect", "good", "poor", "damage", "crash", "no survivors" };
+    return names[c];
+}
+
+const char* calcmethod_name(calcmethod m)
+{
+    static const char* names[] = { "original", "bugfixed", "exact", "undecided" };
+    return names[m];
+}
+
+// counts the evaluations of the exact lowest point solves for simulate().
+class CountSolves : public TurnObserver {
+public:
+    int evaluations{ 0 };
+    void lowest_point_solved(const LanderState&, int n) override { evaluations += n; }
+};
+
+// the turns of simulate() and resimulate() from the start of a turn at schedule[next].
+template <calcmethod method>
+static LandingResult land(LanderState& L, const Schedule& schedule, size_t next, double fr, int turns,
+    int evaluations, const Options& opt, std::vector<Snapshot>* snapshots)
+{
+    LandingResult result;
+    CountSolves solves;
+    result.method = method;
+    result.turns = turns;
+    solves.evaluations = evaluations;
+#ifdef LANDER_STATS
+    stats = Stats{};
+#endif
+    for (;;)
+    {   // prompt_for_k: refused rates are skipped, the last accepted one is kept at the end of the schedule.
+        while (next < schedule.size())
+            if (valid_fuel_rate(schedule[next++])) { fr = schedule[next - 1]; break; }
+        ++result.turns;
+        const turnresult res = L.play_turn<method>(fr, opt, &solves);
+        if (res == TURN_DONE)
+        {
+            if (snapshots)
+                snapshots->push_back(Snapshot{ L.A, L.V, L.M, L.T, fr, (uint32_t)next, result.turns, solves.evaluations });
+            continue;
+        }
+        if (res == FUEL_OUT)
+        {
+            result.fuel_out_T = L.T;
+            L.fall_without_fuel();
+        }
+        break;
+    }
+    result.T = L.T;
+    result.V = L.V;
+    result.fuel = L.fuel();
+    result.solver_evaluations = solves.evaluations;
+#ifdef LANDER_STATS
+    result.stats = stats;
+#endif
+    return result;
+}
+
+static LandingResult land(LanderState& L, const Schedule& schedule, size_t next, double fr, int turns,
+    int evaluations, const Options& opt, std::vector<Snapshot>* snapshots)
+{
+    switch (opt.CalcMethod)
+    {
+    case EXACT: return land<EXACT>(L, schedule, next, fr, turns, evaluations, opt, snapshots);
+    case BUGFIXED: return land<BUGFIXED>(L, schedule, next, fr, turns, evaluations, opt, snapshots);
+    default: return land<ORIGINAL>(L, schedule, next, fr, turns, evaluations, opt, snapshots);
+    }
+}
+
+template <calcmethod method>
+LandingResult simulate(const Schedule& schedule, const Options& opt)
+{
+    LanderState L;
+    return land<method>(L, schedule, 0, 0, 0, 0, opt, nullptr);
+}
+
+template LandingResult simulate<ORIGINAL>(const Schedule&, const Options&);
+template LandingResult simulate<BUGFIXED>(const Schedule&, const Options&);
+template LandingResult simulate<EXACT>(const Schedule&, const Options&);
+
+LandingResult simulate(const Schedule& schedule, const Options& opt)
+{
+    return simulator(opt.CalcMethod)(schedule, opt);
+}
+
+LandingResult simulate(const Schedule& schedule, const Options& opt, std::vector<Snapshot>& snapshots)
+{
+    LanderState L;
+    return land(L, schedule, 0, 0, 0, 0, opt, &snapshots);
+}
+
+LandingResult resimulate(const Snapshot& from, const Schedule& schedule, const Options& opt,
+    std::vector<Snapshot>* snapshots)
+{
+    LanderState L;
+    L.A = from.A;
+    L.V = from.V;
+    L.M = from.M;
+    L.T = from.T;
+    return land(L, schedule, from.next, from.fr, from.turns, from.solver_evaluations, opt, snapshots);
+}
+
+play_turn_fn turn_engine(calcmethod method)
+{
+    switch (method)
+    {
+    case EXACT: return &LanderState::play_turn<EXACT>;
+    case BUGFIXED: return &LanderState::play_turn<BUGFIXED>;
+    default: return &LanderState::play_turn<ORIGINAL>;
+    }
+}
+
+simulate_fn simulator(calcmethod method)
+{
+    switch (method)
+    {
+    case EXACT: return &simulate<EXACT>;
+    case BUGFIXED: return &simulate<BUGFIXED>;
+    default: return &simulate<ORIGINAL>;
+    }
+}
+
+}
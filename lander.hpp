@@ -0,0 +1,211 @@
+// Lander physics and turn engine of the lunar lander game, without any I/O.
+// The interactive game in lunarlander.cpp drives the same code as simulate(),
+// so a schedule fed to simulate() lands exactly as it does when redirected into the game.
+#pragma once
+#include <array>
+#include <cmath>
+#include <stdint.h>
+#include <type_traits>
+#include <vector>
+#include "simd.hpp"
+#include "stats.hpp"
+
+namespace lander {
+
+enum calcmethod { ORIGINAL, BUGFIXED, EXACT, UNDECIDED };
+
+struct Options {
+    calcmethod CalcMethod{ ORIGINAL };
+    // low positive altitude (ft) at the lowest point of a speed reversal which is accepted as a landing,
+    // the engine is switched off and the lander drops to the surface.
+    double maxdropheightft = 5280 * 0.00003858;
+};
+
+struct LanderState;
+
+// Horner's scheme for the terms K to N of the series below, divided by Q^K. Recursive, so that
+// the coefficients are constants of the instantiation.
+template <int K, int N>
+struct taylor_terms {
+    static double speed(double Q) { return 1.0 / K + Q * taylor_terms<K + 1, N>::speed(Q); }
+    static double altitude(double Q) { return 1.0 / (K * (K + 1.0)) + Q * taylor_terms<K + 1, N>::altitude(Q); }
+};
+template <int N>
+struct taylor_terms<N, N> {
+    static double speed(double) { return 1.0 / N; }
+    static double altitude(double) { return 1.0 / (N * (N + 1.0)); }
+};
+// The engine terms of the rocket equation as Taylor series in Q = TF * FR / M, the fraction of the mass
+// burnt, up to Q^N. Speed: -log(1 - Q) = Q + Q^2/2 + Q^3/3 + ...
+template <int N>
+inline double taylor_speed_series(double Q)
+{
+    static_assert(N >= 1, "at least one term");
+    return Q * taylor_terms<1, N>::speed(Q);
+}
+// altitude, per second of burn: ((1 - Q) log(1 - Q) + Q) / Q = Q/2 + Q^2/6 + Q^3/12 + ..., Q^k / (k (k + 1)).
+template <int N>
+inline double taylor_altitude_series(double Q)
+{
+    static_assert(N >= 1, "at least one term");
+    return Q * taylor_terms<1, N>::altitude(Q);
+}
+// bound of the relative truncation error of both series after order n, for 0 <= Q < 1: the tail of the
+// speed series is below Q^(n+1) / ((n + 1)(1 - Q)), its sum above Q. The altitude series does better.
+inline double taylor_error_bound(int n, double Q)
+{
+    double p = 1;
+    for (int k = 0; k < n; ++k) p *= Q;
+    return p / ((n + 1) * (1 - Q));
+}
+// highest order apply_thrust_adaptive() tries before it takes the logarithm.
+const int max_taylor_order = 12;
+
+// Receives the report rows produced during a turn. The default does nothing, simulate() only counts solver evaluations.
+class TurnObserver {
+public:
+    // additional row at the start of each extra pass of the 03.10 loop (il31 > 0).
+    virtual void substep(const LanderState&) {}
+    // landing at the lowest point of a speed reversal, reported before the final drop (if any).
+    virtual void lowest_point(const LanderState&) {}
+    // time to the lowest point found by LanderState::lowest_point_time() (exact method) in that many evaluations.
+    virtual void lowest_point_solved(const LanderState&, int /*evaluations*/) {}
+};
+
+enum turnresult { TURN_DONE, ON_THE_MOON, FUEL_OUT };
+
+// Altitude (mi), Gravity constant, Mass (lbs), Velocity (mi/s), Time (s), Time in turn (s),
+// Altitude at end of turn (mi), Speed at and of turn (mi/s), Fuel rate (lbs/s), Empty mass (lbs),
+// Time left in turn (s), Specific thrust (lbf/pound of fuel)
+// Initial values are those of 01.50 in the original FOCAL code.
+struct LanderState {
+    double A{ 120 }, G{ .001 }, M{ 32500 }, V{ 1 }, T{ 0 }, TF{ 0 }, EndAlt{ 0 }, EndSpeed{ 0 }, FR{ 0 },
+           EmptyMass{ 16500 }, TimeRemain{ 0 }, SpecThrust{ 1.8 };
+
+    double fuel() const { return M - EmptyMass; }
+    // calculate speed, altitude at end of (current part of) the current turn.
+    // The template computes only what its method needs: the 5 term Taylor series or the logarithm.
+    template <calcmethod method> void apply_thrust();
+    void apply_thrust(calcmethod method);
+    // apply_thrust() with the Taylor series to order N. ORIGINAL and BUGFIXED keep the historical
+    // 5 term expression, which order 5 only differs from by rounding.
+    template <int N> void apply_thrust_taylor()
+    {
+        LANDER_COUNT(apply_thrust);
+        const double Q = TF * FR / M;
+        EndSpeed = V + G * TF - SpecThrust * taylor_speed_series<N>(Q);
+        EndAlt = A - G * TF * TF / 2 - V * TF + SpecThrust * TF * taylor_altitude_series<N>(Q);
+    }
+    // apply_thrust() with the lowest order whose error bound (taylor_error_bound) for the current Q is
+    // within tol, relative to the engine terms; exact when no order up to max_taylor_order is.
+    // Returns the order used, 0 for exact.
+    int apply_thrust_adaptive(double tol);
+    // finalize speed, altitude, mass to lander and update time and remaining time in turn (usually 0).
+    void update_lander_state();
+    // altitude after burning t seconds at FR, using the rocket equation (exact method).
+    // Defined here so brent::zero() can inline it into the 08.10 iteration.
+    double getalt(double t) const
+    { return A - 0.5 * G * t * t - V * t - SpecThrust * ((t - M / FR) * simd::log1p(-(t * FR / M)) - t); }
+    // speed after burning t seconds at FR (exact method), minus the derivative of getalt().
+    double getspeed(double t) const { return V + G * t + SpecThrust * simd::log1p(-(t * FR / M)); }
+    // time in [0, tmax] at which getspeed() drops to zero, the lowest point of a speed reversal (08.10),
+    // or tmax if the lander is still descending then. Safeguarded Halley iteration using the closed form
+    // derivatives of getspeed(), falling back to brent::zero() on the bracket found so far.
+    // evaluations (optional) gets the number of getspeed() calls.
+    double lowest_point_time(double tmax, double tol, int* evaluations = nullptr) const;
+    // fly one 10 second turn at fuel rate fr (03.10 to 08.30 in the original FOCAL code).
+    // Returns TURN_DONE if the next fuel rate is due, ON_THE_MOON after landing, or
+    // FUEL_OUT when the tanks are empty; call fall_without_fuel() to finish the landing then.
+    // The template flies method without testing it on the way, opt.CalcMethod is not used;
+    // the other dispatches on opt.CalcMethod every turn (UNDECIDED flies as ORIGINAL).
+    template <calcmethod method> turnresult play_turn(double fr, const Options& opt, TurnObserver* observer = nullptr);
+    turnresult play_turn(double fr, const Options& opt, TurnObserver* observer = nullptr);
+    // free fall to the surface after running out of fuel (04.40).
+    void fall_without_fuel();
+};
+
+enum landingclass { PERFECT, GOOD, POOR, DAMAGE, CRASH, NO_SURVIVORS };
+
+struct LandingResult {
+    double T{ 0 };              // on the moon at (s)
+    double V{ 0 };              // impact velocity (mi/s)
+    double fuel{ 0 };           // fuel left (lbs)
+    double fuel_out_T{ -1 };    // time the fuel ran out (s), negative if it did not
+    int turns{ 0 };             // number of fuel rates used
+    int solver_evaluations{ 0 }; // getspeed() calls of lowest_point_time() (exact method)
+    calcmethod method{ ORIGINAL };
+#ifdef LANDER_STATS
+    Stats stats;                // hot path counters of this landing
+#endif
+    double impact_mph() const { return 3600 * V; }
+};
+
+// A fuel rate per turn, as they would be typed at the FR:= prompt.
+using Schedule = std::vector<double>;
+
+// 0 or between 8 & 200 lbs/sec, as checked at 02.70.
+inline bool valid_fuel_rate(double fr) { return !(fr < 0 || (0 < fr && fr < 8) || fr > 200); }
+
+// landing verdict for an impact velocity in M.P.H. (05.40 to 05.82).
+landingclass classify(double mph);
+const char* landingclass_name(landingclass c);
+const char* calcmethod_name(calcmethod m);
+
+// robust quadratic solver, used to check for numerical issues in the 07.10 loop.
+// Returns false if there are no real roots, otherwise the roots in ascending order.
+bool quadratic(std::array<double, 2>& roots, double a, double b, double c);
+
+template <typename fptype, typename func_type>
+// numerical integration. Added, really, to check on my engine driven altitude gain integral, which should be exact.
+// not needed in the program (anymore), but nice as a check.
+double simpson_rule(fptype a, fptype b, int n, // Number of intervals
+    func_type f)
+{   // https://stackoverflow.com/questions/60005533/composite-simpsons-rule-in-c#61086158
+    fptype h = (b - a) / n;
+    // Internal sample points, there should be n - 1 of them
+    fptype sum_odds = 0.0;
+    for (int i = 1; i < n; i += 2) sum_odds += f(std::fma(i, h, a));
+    fptype sum_evens = 0.0;
+    for (int i = 2; i < n; i += 2) sum_evens += f(std::fma(i, h, a));
+    return (std::fma(2, sum_evens, f(a)) + std::fma(4, sum_odds, f(b))) * h / 3;
+}
+
+// Land a schedule without any I/O. Invalid fuel rates are skipped, as the game refuses them
+// with NOT POSSIBLE and takes the next input. When the schedule is exhausted the last fuel rate
+// is kept, which is what the game does at the end of redirected input.
+LandingResult simulate(const Schedule& schedule, const Options& opt);
+
+// simulate() for one method, opt.CalcMethod is not used.
+template <calcmethod method> LandingResult simulate(const Schedule& schedule, const Options& opt);
+// the instantiations of play_turn() and simulate() for a method, to pick once instead of every turn or landing.
+using play_turn_fn = turnresult (LanderState::*)(double fr, const Options& opt, TurnObserver* observer);
+using simulate_fn = LandingResult (*)(const Schedule& schedule, const Options& opt);
+play_turn_fn turn_engine(calcmethod method);
+simulate_fn simulator(calcmethod method);
+
+// The landing in progress at the start of a turn (start_turn, 02.10): everything play_turn() needs
+// to carry on. The other LanderState members are either the constants of 01.50 or set in the turn
+// before they are read. Plain data, 56 bytes, to be kept in arrays by the million.
+struct Snapshot {
+    double A, V, M, T;          // as LanderState
+    double fr;                  // last accepted fuel rate, kept when the schedule runs out
+    uint32_t next;              // index of the next fuel rate in the schedule
+    int32_t turns;              // turns played
+    int32_t solver_evaluations; // up to here
+};
+static_assert(std::is_trivially_copyable<Snapshot>::value, "Snapshot must be plain data");
+
+// simulate(), appending a snapshot at the start of every turn after the first to snapshots:
+// snapshots[k] is the lander after k + 1 turns. Nothing is appended for the landing turn.
+LandingResult simulate(const Schedule& schedule, const Options& opt, std::vector<Snapshot>& snapshots);
+
+// Carry on a landing from a snapshot with the fuel rates of schedule from index from.next on:
+// the same result as simulate() of the schedule, bit for bit, provided the turns up to the snapshot
+// play the same with it: equal before from.next, and no longer if that schedule ran out before the
+// snapshot. Change turns at or after from.next and resume, instead of landing again from T = 0.
+// Snapshots of the following turns are appended when given.
+// Stats (LANDER_STATS) only count the turns played here.
+LandingResult resimulate(const Snapshot& from, const Schedule& schedule, const Options& opt,
+    std::vector<Snapshot>* snapshots = nullptr);
+
+}
@@ -0,0 +1,134 @@
+// Vectorized physics for many landers, see lander_soa.hpp.
+// The kernels are templates on the vector type of simd.hpp, double being the scalar case,
+// and follow the expressions of lander.cpp operation by operation.
+#include <vector>
+#include "brent.hpp"
+#include "lander.hpp"
+#include "simd.hpp"
+#include "lander_soa.hpp"
+
+namespace lander {
+
+void LanderSoA::resize(size_t n)
+{
+    for (auto* v : { &A, &V, &M, &FR, &TF, &T, &TimeRemain, &EndAlt, &EndSpeed }) v->resize(n);
+}
+
+void LanderSoA::set(size_t i, const LanderState& L)
+{
+    A[i] = L.A; V[i] = L.V; M[i] = L.M; FR[i] = L.FR; TF[i] = L.TF; T[i] = L.T;
+    TimeRemain[i] = L.TimeRemain; EndAlt[i] = L.EndAlt; EndSpeed[i] = L.EndSpeed;
+}
+
+void LanderSoA::get(size_t i, LanderState& L) const
+{
+    L.A = A[i]; L.V = V[i]; L.M = M[i]; L.FR = FR[i]; L.TF = TF[i]; L.T = T[i];
+    L.TimeRemain = TimeRemain[i]; L.EndAlt = EndAlt[i]; L.EndSpeed = EndSpeed[i];
+}
+
+// Subroutine at line 09.10 in original FOCAL code, for the landers at i .. i + width - 1.
+template <typename vd>
+static inline void thrust_lanes(size_t i, const double* pA, const double* pV, const double* pM, const double* pFR,
+    const double* pTF, double G, double SpecThrust, calcmethod method, double* pEndAlt, double* pEndSpeed)
+{
+    const vd A = simd::load(pA + i, vd()), V = simd::load(pV + i, vd()), M = simd::load(pM + i, vd()),
+             FR = simd::load(pFR + i, vd()), TF = simd::load(pTF + i, vd());
+    const vd Q = TF * FR / M;
+    vd EndSpeed, EndAlt;
+    if (method == EXACT)
+    {   // only what the exact method uses, the scalar code calculates both.
+        const vd lq = simd::log1p(-Q);     // log(1 - Q)
+        EndSpeed = V + G * TF + SpecThrust * lq;
+        const vd endalt = A - G * TF * TF / 2 - V * TF;
+        const vd a = FR / M;
+        const vd z = (TF - 1 / a) * lq - TF;
+        EndAlt = simd::select(simd::greater(Q, vd()), endalt - SpecThrust * z, endalt);   // if (Q > 0)
+    }
+    else
+    {
+        const vd Q_2 = Q * Q, Q_3 = Q_2 * Q, Q_4 = Q_3 * Q, Q_5 = Q_4 * Q;
+        EndSpeed = V + G * TF + SpecThrust * (-Q - Q_2 / 2 - Q_3 / 3 - Q_4 / 4 - Q_5 / 5);
+        EndAlt = A - G * TF * TF / 2 - V * TF + SpecThrust * TF * (Q / 2 + Q_2 / 6 + Q_3 / 12 + Q_4 / 20 + Q_5 / 30);
+    }
+    simd::store(pEndSpeed + i, EndSpeed);
+    simd::store(pEndAlt + i, EndAlt);
+}
+
+void apply_thrust(size_t n, const double* A, const double* V, const double* M, const double* FR, const double* TF,
+    double G, double SpecThrust, calcmethod method, double* EndAlt, double* EndSpeed)
+{
+    size_t i = 0;
+#if defined(__AVX512F__) || defined(__AVX2__)
+    for (const size_t w = simd::native::width; i + w <= n; i += w)
+        thrust_lanes<simd::native>(i, A, V, M, FR, TF, G, SpecThrust, method, EndAlt, EndSpeed);
+#endif
+    for (; i < n; ++i)
+        thrust_lanes<double>(i, A, V, M, FR, TF, G, SpecThrust, method, EndAlt, EndSpeed);
+}
+
+void apply_thrust(LanderSoA& s, calcmethod method)
+{
+    apply_thrust(s.size(), s.A.data(), s.V.data(), s.M.data(), s.FR.data(), s.TF.data(), s.G, s.SpecThrust,
+        method, s.EndAlt.data(), s.EndSpeed.data());
+}
+
+// Subroutine at line 06.10 in original FOCAL code, simple enough for the compiler to vectorize.
+void update_lander_state(LanderSoA& s)
+{
+    const size_t n = s.size();
+    double* T = s.T.data(), * TimeRemain = s.TimeRemain.data(), * M = s.M.data(), * A = s.A.data(), * V = s.V.data();
+    const double* TF = s.TF.data(), * FR = s.FR.data(), * EndAlt = s.EndAlt.data(), * EndSpeed = s.EndSpeed.data();
+    for (size_t i = 0; i < n; ++i)
+    {
+        T[i] += TF[i];
+        TimeRemain[i] -= TF[i];
+        M[i] -= TF[i] * FR[i];
+        A[i] = EndAlt[i];
+        V[i] = EndSpeed[i];
+    }
+}
+
+template <typename vd>
+static inline void getalt_lanes(size_t i, const double* pA, const double* pV, const double* pM, const double* pFR,
+    const double* pt, double G, double SpecThrust, double* palt)
+{
+    const vd A = simd::load(pA + i, vd()), V = simd::load(pV + i, vd()), M = simd::load(pM + i, vd()),
+             FR = simd::load(pFR + i, vd()), t = simd::load(pt + i, vd());
+    simd::store(palt + i, A - 0.5 * G * t * t - V * t - SpecThrust * ((t - M / FR) * simd::log1p(-(t * FR / M)) - t));
+}
+
+void getalt(size_t n, const double* A, const double* V, const double* M, const double* FR, const double* t,
+    double G, double SpecThrust, double* alt)
+{
+    size_t i = 0;
+#if defined(__AVX512F__) || defined(__AVX2__)
+    for (const size_t w = simd::native::width; i + w <= n; i += w)
+        getalt_lanes<simd::native>(i, A, V, M, FR, t, G, SpecThrust, alt);
+#endif
+    for (; i < n; ++i)
+        getalt_lanes<double>(i, A, V, M, FR, t, G, SpecThrust, alt);
+}
+
+void getalt(const LanderSoA& s, size_t n, const size_t* lanes, const double* t, double* alt)
+{   // gather the landers asked for, so the kernel runs on contiguous arrays.
+    static thread_local std::vector<double> A, V, M, FR;
+    A.resize(n); V.resize(n); M.resize(n); FR.resize(n);
+    for (size_t j = 0; j < n; ++j)
+    {
+        const size_t i = lanes[j];
+        A[j] = s.A[i]; V[j] = s.V[i]; M[j] = s.M[i]; FR[j] = s.FR[i];
+    }
+    getalt(n, A.data(), V.data(), M.data(), FR.data(), t, s.G, s.SpecThrust, alt);
+}
+
+void altitude_zero(const LanderSoA& s, double tol, double* t, int* status)
+{
+    const std::vector<double> zeros(s.size(), 0.0);
+    brent::zero_batch(s.size(), zeros.data(), s.TF.data(), tol,
+        [&s](size_t n, const size_t* lanes, const double* x, double* fx) { getalt(s, n, lanes, x, fx); },
+        t, status);
+}
+
+const char* soa_isa() { return simd::isa(); }
+
+}
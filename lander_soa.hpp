@@ -0,0 +1,47 @@
+// Many landers in structure-of-arrays form, advanced together by vectorized physics.
+// Meant for sweeps (Monte Carlo, grid searches) where apply_thrust() is the innermost loop.
+// Each lane gives exactly the result of LanderState::apply_thrust() / update_lander_state(),
+// for all three calculation methods, see simd.hpp for the conditions.
+#pragma once
+#include <stddef.h>
+#include <vector>
+#include "lander.hpp"
+
+namespace lander {
+
+struct LanderSoA {
+    std::vector<double> A, V, M, FR, TF, T, TimeRemain, EndAlt, EndSpeed;
+    // shared by all landers, see LanderState.
+    double G{ .001 }, SpecThrust{ 1.8 };
+
+    size_t size() const { return A.size(); }
+    void resize(size_t n);
+    // copy lander i from / to a LanderState (G and SpecThrust are not per lander).
+    void set(size_t i, const LanderState& L);
+    void get(size_t i, LanderState& L) const;
+};
+
+// LanderState::apply_thrust() for every lander: EndAlt and EndSpeed from A, V, M, FR, TF.
+void apply_thrust(LanderSoA& s, calcmethod method);
+// the same on bare arrays of n landers.
+void apply_thrust(size_t n, const double* A, const double* V, const double* M, const double* FR, const double* TF,
+    double G, double SpecThrust, calcmethod method, double* EndAlt, double* EndSpeed);
+// LanderState::update_lander_state() for every lander.
+void update_lander_state(LanderSoA& s);
+
+// LanderState::getalt() for n landers: alt[i] is the altitude of lander i after burning t[i] s at FR[i].
+void getalt(size_t n, const double* A, const double* V, const double* M, const double* FR, const double* t,
+    double G, double SpecThrust, double* alt);
+// the same for the landers listed in lanes, as asked for by brent::zero_batch().
+void getalt(const LanderSoA& s, size_t n, const size_t* lanes, const double* t, double* alt);
+// for every lander the time in [0, TF] where getalt() is zero (touchdown), with brent::zero
+// run for all landers in lockstep.
+// Landers without a change of sign get NaN, and -1 in status (optional).
+// The turn engine no longer solves for this zero (the exact lowest point is a zero of the speed,
+// lowest_point_time()); it is for sweeps asking when many landers touch down.
+void altitude_zero(const LanderSoA& s, double tol, double* t, int* status = nullptr);
+
+// instruction set the batched physics was compiled for: "avx512", "avx2" or "scalar".
+const char* soa_isa();
+
+}
@@ -0,0 +1,399 @@
+// Benchmarks of the physics and solver hot paths: apply_thrust() for each calcmethod, getalt(),
+// the lowest point solve, the Brent solvers (including the cost of reaching the objective through
+// std::function, the virtual func_base::operator() or a function pointer against the templates in
+// brent.hpp, which call it directly), quadratic(), simpson_rule<>, monicPoly/Poly, a replay of
+// a whole landing through simulate() and a sweep of its burn turn: from the start, with PrefixCache
+// and resuming from a Snapshot. The batched physics of lander_soa.hpp is timed per lander, simd::log1p
+// per argument against the C library's log1p, the touchdown times of altitude_zero() (brent::zero_batch)
+// per lander against brent::zero one lander at a time; a summary after the suite gives the speedup of
+// each batched path over the one it replaces.
+// --taylor prints the error of the Taylor series of apply_thrust() at each order against the exact method.
+// Every benchmark runs a number of rounds; ns/op is the median round, with mean, minimum, standard
+// deviation and throughput. --json writes the same to a file for comparing runs.
+// Not part of the game, build it on its own:
+//    cl /O2 /EHsc lunarbench.cpp lander.cpp lander_soa.cpp brent.cpp prefixcache.cpp
+//    g++ -O2 -ffp-contract=off lunarbench.cpp lander.cpp lander_soa.cpp brent.cpp prefixcache.cpp -o lunarbench
+// (/arch:AVX2 or -mavx2 etc for the vector lanes of the batched physics)
+// usage: lunarbench [--rounds <n>] [--scale <x>] [--json <file>] [--replay <file>] [--taylor] [name filter]
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <functional>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "brent.hpp"
+#include "lander.hpp"
+#include "lander_soa.hpp"
+#include "prefixcache.hpp"
+#include "simd.hpp"
+
+static volatile double sink;        // keeps the results alive
+static double shift;                // changed every operation, so nothing can be hoisted out of the loop
+
+// the same parabola as function, as func_base and as lambda below. Minimum at x = 0.3.
+static double parabola(double x) { return x * x - 0.6 * x + shift; }
+struct Parabola : brent::func_base {
+    double operator()(double x) override { return x * x - 0.6 * x + shift; }
+};
+
+struct BenchResult {
+    std::string name;
+    long ops;                       // operations per round
+    double median, mean, min, stddev;   // ns per operation over the rounds
+    double ops_per_sec() const { return 1e9 / median; }
+};
+
+static int rounds = 9;
+static double scale = 1;
+static const char* filter = nullptr;
+static std::vector<BenchResult> results;
+
+// time ops calls of op(i) per round. One round is run first to warm up.
+// An op that handles per items (landers of a batch) is reported per item.
+template <typename F>
+static void bench(const char* name, long ops, F&& op, long per = 1)
+{
+    if (filter && !strstr(name, filter)) return;
+    ops = std::max(1L, (long)(ops * scale));
+    std::vector<double> ns(rounds);
+    for (int r = -1; r < rounds; ++r)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < ops; ++i) op(i);
+        const std::chrono::duration<double, std::nano> t = std::chrono::steady_clock::now() - start;
+        if (r >= 0) ns[r] = t.count() / ((double)ops * per);
+    }
+    BenchResult res{ name, ops, 0, 0, 0, 0 };
+    for (double x : ns) res.mean += x / rounds;
+    for (double x : ns) res.stddev += (x - res.mean) * (x - res.mean);
+    res.stddev = rounds > 1 ? sqrt(res.stddev / (rounds - 1)) : 0;
+    std::sort(ns.begin(), ns.end());
+    res.median = rounds % 2 ? ns[rounds / 2] : 0.5 * (ns[rounds / 2 - 1] + ns[rounds / 2]);
+    res.min = ns[0];
+    printf("%-36s %10.2f ns/op  mean %10.2f  min %10.2f  sd %8.2f (%4.1f%%) %12.0f op/s\n", name, res.median,
+        res.mean, res.min, res.stddev, 100 * res.stddev / res.mean, res.ops_per_sec());
+    results.push_back(res);
+}
+
+static const BenchResult* find_result(const char* name)
+{
+    for (const BenchResult& r : results) if (r.name == name) return &r;
+    return nullptr;
+}
+
+// the batched paths against the one lander (or argument) at a time paths, where both ran.
+static void speedup_summary()
+{
+    static const char* pairs[][2] = {
+        { "soa/apply_thrust/original", "apply_thrust/original" },
+        { "soa/apply_thrust/bugfixed", "apply_thrust/bugfixed" },
+        { "soa/apply_thrust/exact", "apply_thrust/exact" },
+        { "log1p/simd batch", "log1p/libm" },
+        { "log1p/simd batch", "log1p/simd scalar" },
+        { "altitude_zero/zero_batch", "altitude_zero/brent::zero" } };
+    bool header = false;
+    for (const auto& p : pairs)
+    {
+        const BenchResult* batched = find_result(p[0]), * single = find_result(p[1]);
+        if (!batched || !single) continue;
+        if (!header) { printf("speedup (median):\n"); header = true; }
+        printf("  %-34s %6.2fx  over %s\n", p[0], single->median / batched->median, p[1]);
+    }
+}
+
+static bool write_json(const char* path)
+{
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    fprintf(f, "{\n  \"isa\": \"%s\",\n  \"rounds\": %d,\n  \"benchmarks\": [\n", simd::isa(), rounds);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchResult& r = results[i];
+        fprintf(f, "    { \"name\": \"%s\", \"ops\": %ld, \"ns_per_op\": %.4f, \"mean_ns\": %.4f, \"min_ns\": %.4f, "
+            "\"stddev_ns\": %.4f, \"ops_per_sec\": %.1f }%s\n", r.name.c_str(), r.ops, r.median, r.mean, r.min,
+            r.stddev, r.ops_per_sec(), i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return fclose(f) == 0;
+}
+
+// fuel rates as they would be redirected into the game: numbers up to the first thing that is not one.
+static bool read_schedule(const char* path, lander::Schedule& schedule)
+{
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    double fr;
+    while (fscanf(f, "%lf", &fr) == 1) schedule.push_back(fr);
+    fclose(f);
+    return !schedule.empty();
+}
+
+// the Taylor orders of the report, as series and as apply_thrust_taylor<N> members.
+static double (* const speed_series[])(double) = { lander::taylor_speed_series<1>, lander::taylor_speed_series<2>,
+    lander::taylor_speed_series<3>, lander::taylor_speed_series<4>, lander::taylor_speed_series<5>,
+    lander::taylor_speed_series<6>, lander::taylor_speed_series<7>, lander::taylor_speed_series<8> };
+typedef void (lander::LanderState::* thrust_fn)();
+static const thrust_fn taylor_orders[] = { &lander::LanderState::apply_thrust_taylor<1>,
+    &lander::LanderState::apply_thrust_taylor<2>, &lander::LanderState::apply_thrust_taylor<3>,
+    &lander::LanderState::apply_thrust_taylor<4>, &lander::LanderState::apply_thrust_taylor<5>,
+    &lander::LanderState::apply_thrust_taylor<6>, &lander::LanderState::apply_thrust_taylor<7>,
+    &lander::LanderState::apply_thrust_taylor<8> };
+
+// For a burn of Q (fraction of the mass) by a full lander at 200 lbs/s: the relative error of the speed
+// series (measured in long double, and its bound) and the errors of the end speed and altitude against
+// apply_thrust<EXACT>, per order. Q = 0.0615 is a full turn at 200 lbs/s, 0.108 one with the tanks near empty.
+static void taylor_report()
+{
+    static const double Qs[] = { 0.001, 0.01, 0.03, 0.0615, 0.108 };
+    printf("%-7s %5s %12s %12s %14s %14s\n", "Q", "order", "speed rel", "bound", "EndSpeed mph", "EndAlt ft");
+    for (double Q : Qs)
+    {
+        lander::LanderState L;
+        L.A = 5; L.V = 0.5; L.FR = 200; L.TF = Q * L.M / L.FR;
+        L.apply_thrust<lander::EXACT>();
+        const double speed = L.EndSpeed, alt = L.EndAlt;
+        const long double exact_series = -log1pl(-(long double)Q);
+        for (size_t n = 1; n <= sizeof(taylor_orders) / sizeof(taylor_orders[0]); ++n)
+        {
+            (L.*taylor_orders[n - 1])();
+            const long double series = speed_series[n - 1](Q);
+            printf("%-7g %5zu %12.3e %12.3e %14.3e %14.3e\n", Q, n, (double)fabsl(series / exact_series - 1),
+                lander::taylor_error_bound((int)n, Q), 3600 * fabs(L.EndSpeed - speed), 5280 * fabs(L.EndAlt - alt));
+        }
+        L.apply_thrust(lander::ORIGINAL);
+        printf("%-7g %5s %12s %12s %14.3e %14.3e\n", Q, "5 old", "", "", 3600 * fabs(L.EndSpeed - speed),
+            5280 * fabs(L.EndAlt - alt));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const char* json = nullptr;
+    const char* replay = "inputsuicideburns.txt";
+    for (int ia = 1; ia < argc; ++ia)
+    {
+        if (!strcmp(argv[ia], "--rounds") && ia + 1 < argc) rounds = std::max(1, atoi(argv[++ia]));
+        else if (!strcmp(argv[ia], "--scale") && ia + 1 < argc) scale = atof(argv[++ia]);
+        else if (!strcmp(argv[ia], "--json") && ia + 1 < argc) json = argv[++ia];
+        else if (!strcmp(argv[ia], "--replay") && ia + 1 < argc) replay = argv[++ia];
+        else if (!strcmp(argv[ia], "--taylor")) { taylor_report(); return 0; }
+        else if (argv[ia][0] != '-') filter = argv[ia];
+        else
+        {
+            fprintf(stderr, "usage: %s [--rounds <n>] [--scale <x>] [--json <file>] [--replay <file>] [--taylor] [name filter]\n",
+                argv[0]);
+            return 1;
+        }
+    }
+    printf("lunarbench: %d rounds, %s\n", rounds, simd::isa());
+
+    // a lander in the landing turn: low, slow, braking hard.
+    lander::LanderState L;
+    L.A = 0.02; L.V = 0.03; L.M = 25000; L.FR = 200; L.TF = 10;
+    const double A0 = L.A;
+
+    // === physics
+    static const char* method_bench[] = { "apply_thrust/original", "apply_thrust/bugfixed", "apply_thrust/exact" };
+    for (int m = lander::ORIGINAL; m <= lander::EXACT; ++m)
+        bench(method_bench[m], 2000000, [&L, m](long i) {
+            L.TF = 0.5 + (i & 1023) * 0.009;
+            L.apply_thrust((lander::calcmethod)m);
+            sink = L.EndAlt;
+        });
+    static const char* taylor_bench[] = { "apply_thrust/taylor1", "apply_thrust/taylor2", "apply_thrust/taylor3",
+        "apply_thrust/taylor4", "apply_thrust/taylor5", "apply_thrust/taylor6", "apply_thrust/taylor7", "apply_thrust/taylor8" };
+    for (size_t n = 0; n < sizeof(taylor_orders) / sizeof(taylor_orders[0]); ++n)
+    {
+        const thrust_fn thrust = taylor_orders[n];
+        bench(taylor_bench[n], 2000000, [&L, thrust](long i) {
+            L.TF = 0.5 + (i & 1023) * 0.009;
+            (L.*thrust)();
+            sink = L.EndAlt;
+        });
+    }
+    bench("apply_thrust/adaptive 1e-6", 2000000, [&L](long i) {
+        L.TF = 0.5 + (i & 1023) * 0.009;
+        sink = L.apply_thrust_adaptive(1e-6);
+    });
+    bench("apply_thrust/adaptive 1e-12", 2000000, [&L](long i) {
+        L.TF = 0.5 + (i & 1023) * 0.009;
+        sink = L.apply_thrust_adaptive(1e-12);
+    });
+    {   // 1024 landers with the same spread of TF, ns per lander.
+        const size_t n = 1024;
+        lander::LanderSoA soa;
+        soa.resize(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            L.TF = 0.5 + i * 0.009;
+            soa.set(i, L);
+        }
+        static const char* soa_bench[] = { "soa/apply_thrust/original", "soa/apply_thrust/bugfixed", "soa/apply_thrust/exact" };
+        for (int m = lander::ORIGINAL; m <= lander::EXACT; ++m)
+            bench(soa_bench[m], 2000000 / n, [&soa, m](long i) {
+                lander::apply_thrust(soa, (lander::calcmethod)m);
+                sink = soa.EndAlt[i & 1023];
+            }, (long)n);
+    }
+    {   // the log1p(-Q) of the exact method: the C library, the scalar instance and 1024 at a time.
+        const size_t n = 1024;
+        std::vector<double> x(n), y(n);
+        for (size_t i = 0; i < n; ++i) x[i] = -0.121 * i / n;
+        bench("log1p/libm", 2000000, [&x](long i) { sink = log1p(x[i & 1023]); });
+        bench("log1p/simd scalar", 2000000, [&x](long i) { sink = simd::log1p(x[i & 1023]); });
+        bench("log1p/simd batch", 2000000 / n, [&x, &y](long i) {
+            size_t j = 0;
+#         if defined(__AVX512F__) || defined(__AVX2__)
+            for (const size_t w = simd::native::width; j + w <= x.size(); j += w)
+                simd::store(&y[j], simd::log1p(simd::load(&x[j], simd::native())));
+#         endif
+            for (; j < x.size(); ++j) y[j] = simd::log1p(x[j]);
+            sink = y[i & 1023];
+        }, (long)n);
+    }
+    {   // 1024 landers low over the surface, all of them touching down within the turn.
+        const size_t n = 1024;
+        lander::LanderSoA soa;
+        soa.resize(n);
+        std::vector<lander::LanderState> landers(n, L);
+        for (size_t i = 0; i < n; ++i)
+        {
+            landers[i].A = 0.001 + i * 2e-5;
+            landers[i].FR = 20;         // too little to stop the descent
+            landers[i].TF = 10;
+            soa.set(i, landers[i]);
+        }
+        std::vector<double> t(n);
+        bench("altitude_zero/brent::zero", 200000 / n, [&landers, &t](long i) {
+            for (size_t j = 0; j < landers.size(); ++j)
+            {
+                const lander::LanderState& S = landers[j];
+                t[j] = S.getalt(0) * S.getalt(S.TF) <= 0 ? brent::zero(0, S.TF, 1e-9, [&S](double x) { return S.getalt(x); }) : NAN;
+            }
+            sink = t[i & 1023];
+        }, (long)n);
+        bench("altitude_zero/zero_batch", 200000 / n, [&soa, &t](long i) {
+            lander::altitude_zero(soa, 1e-9, t.data());
+            sink = t[i & 1023];
+        }, (long)n);
+    }
+    L.TF = 10;
+    bench("getalt", 2000000, [&L](long i) { sink = L.getalt((i & 1023) * 0.009); });
+    bench("getspeed", 2000000, [&L](long i) { sink = L.getspeed((i & 1023) * 0.009); });
+    bench("lowest_point_time", 500000, [&L](long i) {
+        L.V = 0.03 + (i & 1023) * 1e-6;
+        sink = L.lowest_point_time(10, 1e-9);
+    });
+    L.V = 0.03;
+    bench("quadratic", 2000000, [](long i) {
+        std::array<double, 2> roots;
+        lander::quadratic(roots, 0.5 * (-0.005 + (i & 1023) * 1e-6), 0.03, -0.02);
+        sink = roots[0];
+    });
+    bench("simpson_rule/10", 1000000, [](long i) {
+        const double a = 200. / (25000 + (i & 1023));
+        sink = lander::simpson_rule<double>(0., 10., 10, [a](double t) { return simd::log1p(-a * t); });
+    });
+    {
+        brent::monicPoly monic(std::vector<double>{ -5, -2, 0, 1.5, -0.5 });
+        brent::Poly poly(std::vector<double>{ -5, -2, 0, 1.5, -0.5, 1 });
+        bench("monicPoly/degree5", 2000000, [&monic](long i) { sink = monic((i & 1023) * 0.001); });
+        bench("Poly/degree5", 2000000, [&poly](long i) { sink = poly((i & 1023) * 0.001); });
+    }
+
+    // === solvers. The lambda is inlined into the templates, the others cost a call per evaluation.
+    {
+        auto getalt = [&L](double t) { return L.getalt(t); };
+        const std::function<double(double)> getalt_function = getalt;
+        bench("brent::zero/getalt lambda", 200000, [&](long i) {
+            L.A = A0 + i * 1e-12;
+            sink = brent::zero(0, L.TF, 1e-9, getalt);
+        });
+        bench("brent::zero/getalt std::function", 200000, [&](long i) {
+            L.A = A0 + i * 1e-12;
+            sink = brent::zero(0, L.TF, 1e-9, getalt_function);
+        });
+        L.A = A0;
+
+        Parabola virt;
+        auto lambda = [](double x) { return x * x - 0.6 * x + shift; };
+        double x;
+        bench("brent::local_min/lambda", 500000, [&](long i) {
+            shift = i * 1e-9;
+            sink = brent::local_min(-1, 1, 1e-9, lambda, x);
+        });
+        bench("brent::local_min/func_base virtual", 500000, [&](long i) {
+            shift = i * 1e-9;
+            sink = brent::local_min(-1, 1, 1e-9, static_cast<brent::func_base&>(virt), x);
+        });
+        bench("brent::local_min/function pointer", 500000, [&](long i) {
+            shift = i * 1e-9;
+            sink = brent::local_min(-1, 1, 1e-9, parabola, x);
+        });
+        bench("brent::glomin/lambda", 100000, [&](long i) {
+            shift = i * 1e-9;
+            sink = brent::glomin(-1, 1, 0, 2, 1e-12, 1e-9, lambda, x);
+        });
+        bench("brent::glomin/func_base virtual", 100000, [&](long i) {
+            shift = i * 1e-9;
+            sink = brent::glomin(-1, 1, 0, 2, 1e-12, 1e-9, static_cast<brent::func_base&>(virt), x);
+        });
+        bench("brent::glomin/function pointer", 100000, [&](long i) {
+            shift = i * 1e-9;
+            sink = brent::glomin(-1, 1, 0, 2, 1e-12, 1e-9, parabola, x);
+        });
+    }
+
+    // === a whole landing
+    lander::Schedule schedule;
+    if (read_schedule(replay, schedule))
+    {
+        static const char* replay_bench[] = { "replay/original", "replay/bugfixed", "replay/exact" };
+        for (int m = lander::ORIGINAL; m <= lander::EXACT; ++m)
+        {
+            lander::Options opt;
+            opt.CalcMethod = (lander::calcmethod)m;
+            bench(replay_bench[m], 20000, [&schedule, &opt](long) { sink = lander::simulate(schedule, opt).V; });
+        }
+        // vary the first burn (turn 8 in inputsuicideburns.txt), the turns before it are shared.
+        size_t burn = 0;
+        while (burn + 1 < schedule.size() && schedule[burn] == 0) ++burn;
+        lander::Options opt;
+        opt.CalcMethod = lander::EXACT;
+        lander::Schedule sweep = schedule;
+        bench("sweep/exact", 20000, [&](long i) {
+            sweep[burn] = schedule[burn] + (i & 255) * 1e-6;
+            sink = lander::simulate(sweep, opt).V;
+        });
+        lander::PrefixCache cache;
+        bench("sweep/exact PrefixCache", 20000, [&](long i) {
+            sweep[burn] = schedule[burn] + (i & 255) * 1e-6;
+            sink = cache.simulate(sweep, opt).V;
+        });
+        if (cache.counters().landings)
+            printf("%-36s %9.1f%% of the turns resumed\n", "  PrefixCache hit rate", 100 * cache.counters().hit_rate());
+        std::vector<lander::Snapshot> snapshots;
+        lander::simulate(schedule, opt, snapshots);
+        if (burn > 0 && burn <= snapshots.size())
+        {   // resume at the start of the burn turn.
+            const lander::Snapshot from = snapshots[burn - 1];
+            bench("sweep/exact resimulate", 20000, [&](long i) {
+                sweep[burn] = schedule[burn] + (i & 255) * 1e-6;
+                sink = lander::resimulate(from, sweep, opt).V;
+            });
+        }
+    }
+    else fprintf(stderr, "%s: no fuel rates, replay skipped\n", replay);
+    speedup_summary();
+
+    if (json && !write_json(json))
+    {
+        fprintf(stderr, "cannot write %s\n", json);
+        return 1;
+    }
+    return 0;
+}
@@ -43,77 +43,37 @@ But with those changes I do get a very gentle 
 #include <string>
 #include <functional>
 #include "brent.hpp"
-template <typename fptype, typename func_type>
-// numerical integration. Added, really, to check on my engine driven altitude gain integral, which should be exact.
-// not needed in the program (anymore), but nice as a check.
-double simpson_rule(fptype a, fptype b, int n, // Number of intervals
-    func_type f)
-{   // https://stackoverflow.com/questions/60005533/composite-simpsons-rule-in-c#61086158
-    fptype h = (b - a) / n;
-    // Internal sample points, there should be n - 1 of them
-    fptype sum_odds = 0.0;
-    for (int i = 1; i < n; i += 2) sum_odds += f(std::fma(i, h, a));
-    fptype sum_evens = 0.0;
-    for (int i = 2; i < n; i += 2) sum_evens += f(std::fma(i, h, a));
-    return (std::fma(2, sum_evens, f(a)) + std::fma(4, sum_odds, f(b))) * h / 3;
-}
-
-// quadratic is a robust quadratic solver to find out whether numerical issues occur.
-static bool quadratic(std::array<double, 2>& roots, double a, double b, double c)
-{   // https://en.wikipedia.org/wiki/Quadratic_formula#Square_root_in_the_denominator and note 22
-    // todo: complete using complex numbers. See commented lines, also at bottom of file.
-    auto sgn = [](const double x) {return x > 0 ? 1 : (x < 0 ? -1 : 0); };
-    if (a == 0) return false; const double b1 = b / a, c1 = c / a;
-    if (b == 0) { roots = { -sqrt(-c1),  -roots[0] }; return true; } // ascending order
-    if (c == 0) { roots = { -b1, 0 }; return true; }
-    double y1 = 0, y2 = 0;
-    const double c1abs = fabs(c1), scale = sqrt(c1abs) * sgn(b1), beta = b1 / (2 * scale), sc = sgn(c1);
-    // if (isreal([b1,c1])
-    {
-        if (sc == -1) { y1 = beta + sqrt(beta * beta + 1); y2 = -1 / y1; }
-        else if (beta >= 1)
-        { y1 = beta + sqrt((beta + 1) * (beta - 1)); y2 = 1 / y1; }
-        else return false;  // alleen complexe oplossingen.
-        //else
-        //{   // imaginair, zie gebruik j in complex.
-        //    const auto im = sqrt((beta + 1) * (1 - beta));
-        //    y1 = beta + j * im; y2 = beta - j * im;
-        //}
-    }
-    //else
-    //{   // with complex coefficients
-    //    scale = sgn(b1) * (sqrt(abs(c1)));
-    //    beta = abs(b1) / (2 * sqrt(abs(c1)));
-    //    f = sqrt(sgn(c1)) / sgn(b1);
-    //    gamma = sqrt((beta - f) * (beta + f));
-    //    y1 = beta + sign(real(gamma)) * gamma;
-    //    y2 = f ^ 2 / y1;
-    //}
-    roots = { -y1 * scale, -y2 * scale };
-    if (roots[0] > roots[1]) std::swap(roots[0], roots[1]);
-    return true;
-}
+#include "lander.hpp"
+#include "batch.hpp"
+#include "divergence.hpp"
+#include "input.hpp"
+#include "output.hpp"
+#include "stats.hpp"
+#include "trajectory.hpp"
+#include "session.hpp"
+#include "server.hpp"
+#include "solve.hpp"
+#include "policy.hpp"
 static bool find_parentprocess(std::string& fname);
 
-// Altitude (mi), Gravity constant, Mass (lbs), Velocity (mi/s), Time (s), Time in turn (s),
-// Altitude at end of turn (mi), Speed at and of turn (mi/s), Time left in turn (s), Specific thrust (lbf/pound of fuel)
-static double A, G, M, V, T, TF, X, EndAlt, EndSpeed, FR, EmptyMass, TimeRemain, SpecThrust;
-#define Fuel (M - EmptyMass)
-static double maxdropheightft = 5280 * 0.00003858;
+// The lander state (altitude, speed, mass, time etc) and physics live in lander.hpp/lander.cpp.
+// Calculation method and max drop height are set from the command line.
+static lander::Options Opts{ lander::UNDECIDED };
 static bool echo_input = false, RedirectedInput = false;
-enum calcmethod { ORIGINAL, BUGFIXED, EXACT, UNDECIDED };
-static calcmethod CalcMethod{ UNDECIDED };
-
-
-// calculate speed, altitude at end of (current part of) the current turn.
-static void apply_thrust();
-// finalize speed, altitude, mass to lander and update time and remaining time in turn (usually 0).
-static void update_lander_state();
+// All game output goes through one buffer (output.hpp). --quiet prints only the landing,
+// --csv a row per landing instead.
+static lander::Output out(stdout);
+static bool quiet = false, csv = false;
+// Redirected input can hold a stream of games: a line starting with Y (as the answer to TRY AGAIN?)
+// or with --- starts the next game, a line starting with N ends the stream.
+static lander::LineReader input(stdin);
+static bool game_input_ended = false;   // the delimiter after the fuel rates of this game was read
+static bool is_game_delimiter(const char* line);
 
 // Input routines (substitutes for FOCAL ACCEPT command).
 static bool accept_double(double *value);
 static int accept_yes_or_no();
-static bool accept_line(char **buffer, int *buffer_length);
+static const char* accept_line(size_t *length = nullptr);
 // Added key wait in case program is launched from e.g. explorer, not cmd etc, otherwise the ouput just disappears.
 // Checks as best as possible whether this is needed (against twice press a key).
 // The check is Windows only, since I could not find a portable CalcMethod for determining parent program (name) - and then, what.
@@ -122,20 +82,54 @@ static bool accept_line(char **buffer, int *buffer_length);
 #endif
 // Optional arguments:
 // --echo (see below)
+// --batch <file> [--threads <n>] [--cache <MB>], see telwhat(), batch.hpp and prefixcache.hpp.
+// --stats[=json], hot path counters per landing, see stats.hpp.
+// --compare <file> [--threshold <mph>] [--turns], all calc methods in lockstep, see divergence.hpp.
+// --quiet, only the landing. --csv, a csv row per landing.
+// --trajectory <file>, the rows of every landing as binary records, see trajectory.hpp.
+// --serve <socket> [--threads <n>], answer landing queries on a local socket, --query <socket> the client, see server.hpp.
+// --solve <file> [--limit <mph>] [--threads <n>], the free fuel rates of schedule templates, see solve.hpp.
+// --optimize <file> [--cost impact|fuel|time] [--limit <mph>], whole schedules, see solve.hpp.
+// --policy <file> [--grid <a>x<v>x<m>] [--rates <n>], the optimal policy table, see policy.hpp.
+// --autopilot <file>, the policy table answers FR:= instead of the player.
+// Redirected input can hold many games, separated by YES or --- lines, see accept_yes_or_no().
 // calc(CalcMethod)=[original|old || new|fixed || exact], default original. see message.
 
-static double getalt(const double t)
-{ return A - 0.5 * G * t * t - V * t - SpecThrust * ((t - M / FR) * log(1 - t * FR / M) - t); };
+// Prints a row of the game's table as the session hands it out (session.hpp). The landing itself
+// (05.10) is printed after the rows.
+static void print_row(const lander::TrajectoryRecord& r)
+{
+    switch (r.kind)
+    {
+    case lander::TRAJ_TURN:     // 02.10, "%7.0f%16.0f%7.0f%15.2f%12.1f      "
+        out.fixed(r.T, 7, 0).fixed(trunc(r.A), 16, 0).fixed(5280 * (r.A - trunc(r.A)), 7, 0).fixed(3600 * r.V, 15, 2)
+            .fixed(r.fuel, 12, 1).text("      ");
+        break;
+    case lander::TRAJ_SUBSTEP:  // "%11.3f%12.0f%+7.0f%15.2f%12.1f      FR  %.6lf\n"
+        out.fixed(r.T, 11, 3).fixed(trunc(r.A), 12, 0).fixed(5280 * (r.A - trunc(r.A)), 7, 0, true).fixed(3600 * r.V, 15, 2)
+            .fixed(r.fuel, 12, 1).text("      FR  ").fixed(r.FR, 0, 6).put('\n');
+        break;
+    case lander::TRAJ_LOWEST_POINT: // "%11.3f%12.0f%+7.1f%15.2f%12.1f      FR  %.6lf\n", V is the speed there
+        out.fixed(r.T, 11, 3).fixed(trunc(r.A), 12, 0).fixed(5280 * (r.A - trunc(r.A)), 7, 1, true).fixed(3600 * r.V, 15, 2)
+            .fixed(r.fuel, 12, 1).text("      FR  ").fixed(r.FR, 0, 6).put('\n');
+        break;
+    case lander::TRAJ_FUEL_OUT: // 04.10
+        out.text("\nFUEL OUT AT ").fixed(r.T, 8, 2).line(" SECS");
+        break;
+    default:
+        break;
+    }
+}
 
 static void telwhat(const char *argv0)
 {
     const char* fn = strrchr(argv0, '\\');
     if (!fn) fn = strrchr(argv0, '/');
     if (!fn) fn = argv0; else ++fn;
-    fputs(fn, stdout);
+    out.text(fn);
     if (strncmp(fn, "lunarlander", 11))
-        fputs(", aka lunarlander", stdout);
-    puts(
+        out.text(", aka lunarlander");
+    out.line(
         "written originally by Jim Storer in 1969,\n"
         "shortly after the first moon landing, using Focal on a PDP8\n"
         "and ported later to basic and C.\n"
@@ -159,6 +153,38 @@ static void telwhat(const char *argv0)
         "Exact means using the rocket equation with a logarithm for thrust application\n"
         "and a primitive for the altitude calculation, rather than Taylor terms.\n"
         "As in other ports, --echo prints input, which is useful with redirected input.\n"
+        "--batch <file> lands every line of fuel rates in the file (use - for stdin) and\n"
+        "prints one csv row per landing instead of playing the game. The landings are\n"
+        "spread over all cores, or over the number given by --threads <n>.\n"
+        "--cache <MB> lets schedules with the same first turns resume from the lander\n"
+        "state after them instead of landing from the start; the hit rate goes to stderr.\n"
+        "--stats prints counters of the turn engine after each landing (--stats=json as\n"
+        "json), in builds with LANDER_STATS defined. With --batch the totals go to stderr.\n"
+        "--compare <file> flies every line of fuel rates with all three calculation\n"
+        "methods at once and prints a csv row for those whose speeds differ by more than\n"
+        "--threshold <mph> (default 0) after a turn or at impact, with the turn and time\n"
+        "of touchdown per method. --turns gives a row per turn and method instead.\n"
+        "--quiet prints only the landing (from ON THE MOON), --csv only a csv row per\n"
+        "landing, for sweeps over redirected input.\n"
+        "--trajectory <file> writes the rows of every landing as binary records to the\n"
+        "file, for tools that map it into memory; trajdump prints them as the table.\n"
+        "--serve <socket> answers landing queries (a schedule, or a lander state and the\n"
+        "rates from there) on a local socket until stopped; --query <socket> sends the\n"
+        "lines of its input as queries and prints the replies.\n"
+        "--solve <file> finds the fuel rates marked ? (or ?lo:hi) in each line of fuel\n"
+        "rates that give the softest landing, or with --limit <mph> the most fuel left\n"
+        "landing at most that fast, e.g. the suicide burn in 0 0 0 0 0 0 0 ? 200 200 ...\n"
+        "--optimize <file> improves every rate of each line of fuel rates, to minimize\n"
+        "--cost impact (the default), fuel or time; with fuel or time give a --limit.\n"
+        "--policy <file> computes the best fuel rate for every altitude, speed and mass\n"
+        "of a grid (--grid <a>x<v>x<m> cells, default 96x96x24, --rates <n> rates tried,\n"
+        "default 26) by dynamic programming and writes the table to the file.\n"
+        "--autopilot <file> plays with such a table: each FR:= is answered with the best\n"
+        "rate for the altitude, speed and mass at that moment, looked up in the table.\n"
+        "Redirected input can hold many games: after the fuel rates of a game, a line\n"
+        "YES (the answer to TRY AGAIN?) or --- starts the next one, NO ends the input.\n"
+        "Fuel rates left after a landing are skipped, a game that runs out of them\n"
+        "keeps its last rate, as at the end of the input.\n"
         "An additional output has been added at speed-reversal. Altitude is shown signed\n"
         "to allow for a value in feet which is zero after rounding, but can be positive\n"
         "causing a (temporary) fly-off and a subsequent hard landing.\n"
@@ -172,8 +198,27 @@ static void telwhat(const char *argv0)
 int main(int argc, char **argv)
 {
     int turn = 0;
+    double FR = 0;
     const char* calcmess = "original";   // default
     bool dohelp = false;
+    const char* batchfile = nullptr;
+    const char* comparefile = nullptr;
+    double threshold = 0;
+    bool compare_turns = false;
+    unsigned nthreads = 0;
+    double cache_mb = 0;
+    lander::statsformat stats_format = lander::STATS_OFF;
+    const char* trajectoryfile = nullptr;
+    const char* servesocket = nullptr;
+    const char* querysocket = nullptr;
+    const char* solvefile = nullptr;
+    const char* optimizefile = nullptr;
+    lander::SolveOptions solve_options;
+    const char* policyfile = nullptr;
+    lander::PolicyOptions policy_options;
+    const char* autopilotfile = nullptr;
+    lander::PolicyTable autopilot;
+    lander::TrajectoryWriter trajectory;
     for (int ia = 1; ia < argc; ++ia)
     {   // If --echo is present, then write all input back to standard output.
         // (This is useful for testing with files as (redirected) input.)
@@ -182,314 +227,243 @@ int main(int argc, char **argv)
         {
             while (*arg && !isalnum(*arg)) ++ arg;
             if (*arg == 'h' || *arg == '?') dohelp = true;
-            if (!echo_input) echo_input = strcmp(arg, "--echo") == 0;
+            if (!echo_input) echo_input = strcmp(arg, "echo") == 0;
+            // file names are taken as is, not lowercased.
+            if (!strcmp(arg, "batch") && ia + 1 < argc) batchfile = argv[++ia];
+            else if (!strcmp(arg, "threads") && ia + 1 < argc)
+            {
+                const int n = atoi(argv[++ia]);
+                if (n < 0) { fprintf(stderr, "--threads %s: not a number of threads\n", argv[ia]); return 1; }
+                nthreads = (unsigned)n;
+            }
+            else if (!strcmp(arg, "cache") && ia + 1 < argc) cache_mb = atof(argv[++ia]);
+            else if (!strcmp(arg, "compare") && ia + 1 < argc) comparefile = argv[++ia];
+            else if (!strcmp(arg, "threshold") && ia + 1 < argc) threshold = atof(argv[++ia]);
+            else if (!strcmp(arg, "turns")) compare_turns = true;
+            else if (!strcmp(arg, "quiet")) quiet = true;
+            else if (!strcmp(arg, "csv")) csv = true;
+            else if (!strcmp(arg, "trajectory") && ia + 1 < argc) trajectoryfile = argv[++ia];
+            else if (!strcmp(arg, "serve") && ia + 1 < argc) servesocket = argv[++ia];
+            else if (!strcmp(arg, "query") && ia + 1 < argc) querysocket = argv[++ia];
+            else if (!strcmp(arg, "solve") && ia + 1 < argc) solvefile = argv[++ia];
+            else if (!strcmp(arg, "limit") && ia + 1 < argc) solve_options.limit_mph = atof(argv[++ia]);
+            else if (!strcmp(arg, "optimize") && ia + 1 < argc) optimizefile = argv[++ia];
+            else if (!strcmp(arg, "cost") && ia + 1 < argc)
+            {
+                const char* cost = argv[++ia];
+                solve_options.cost = strchr("fF", cost[0]) ? lander::COST_FUEL : strchr("tT", cost[0]) ? lander::COST_TIME
+                    : lander::COST_IMPACT;
+            }
+            else if (!strcmp(arg, "policy") && ia + 1 < argc) policyfile = argv[++ia];
+            else if (!strcmp(arg, "grid") && ia + 1 < argc)
+                sscanf(argv[++ia], "%ux%ux%u", &policy_options.altitudes, &policy_options.speeds, &policy_options.masses);
+            else if (!strcmp(arg, "autopilot") && ia + 1 < argc) autopilotfile = argv[++ia];
+            else if (!strcmp(arg, "rates") && ia + 1 < argc) policy_options.rates = atoi(argv[++ia]);
+            else if (!strncmp(arg, "stats", 5)) stats_format = strstr(arg, "json") ? lander::STATS_JSON : lander::STATS_BLOCK;
             continue;
         }
         char* equals{ nullptr };
         if ((equals = strchr(arg, '=')) != nullptr)
         {
             *equals++ = 0;
-            if (CalcMethod == UNDECIDED && !strncmp(arg, "calc", 4))
+            if (Opts.CalcMethod == lander::UNDECIDED && !strncmp(arg, "calc", 4))
             {
-                if (strstr(equals, "old") || strstr(equals, "orig")) { CalcMethod = ORIGINAL; calcmess = "original"; }
+                if (strstr(equals, "old") || strstr(equals, "orig")) { Opts.CalcMethod = lander::ORIGINAL; calcmess = "original"; }
                 else if (strstr(equals, "new") || strstr(equals, "fixed") || !strncmp(equals, "bugfix", 6))
-                { CalcMethod = BUGFIXED; calcmess = "bugfixed"; }
-                else if (strstr(equals, "exact")) { CalcMethod = EXACT; calcmess = "exact"; }
+                { Opts.CalcMethod = lander::BUGFIXED; calcmess = "bugfixed"; }
+                else if (strstr(equals, "exact")) { Opts.CalcMethod = lander::EXACT; calcmess = "exact"; }
             }
             else if (strstr(arg, "max") && strstr(arg, "drop"))
             {
                 const int e = (int)strlen(arg) - 2;
                 const double x = atof(equals);
-                if (x == 0) maxdropheightft = 0;
-                else { if (e > 0) maxdropheightft = (strcmp(arg + e, "ft") ? 5280 : 1) * x; }
+                if (x == 0) Opts.maxdropheightft = 0;
+                else { if (e > 0) Opts.maxdropheightft = (strcmp(arg + e, "ft") ? 5280 : 1) * x; }
             }
             else { printf("Do not understand %s\n", arg); return 1; }
         }
     }
-    if (CalcMethod == UNDECIDED) CalcMethod = ORIGINAL;
+    if (autopilotfile && !dohelp)
+    {   // without calc= the game is played with the method the table was computed for.
+        if (!autopilot.open(autopilotfile))
+        { fprintf(stderr, "Cannot map policy file %s: %s\n", autopilotfile, autopilot.error()); return 1; }
+        const lander::calcmethod table = (lander::calcmethod)autopilot.header().method;
+        if (Opts.CalcMethod == lander::UNDECIDED) { Opts.CalcMethod = table; calcmess = lander::calcmethod_name(table); }
+        else if (Opts.CalcMethod != table)
+            fprintf(stderr, "--autopilot: the policy was computed for calc=%s\n", lander::calcmethod_name(table));
+    }
+    if (Opts.CalcMethod == lander::UNDECIDED) Opts.CalcMethod = lander::ORIGINAL;
+    if (stats_format != lander::STATS_OFF && !lander::stats_compiled_in)
+    {
+        fputs("--stats: no counters in this build, compile with LANDER_STATS defined.\n", stderr);
+        stats_format = lander::STATS_OFF;
+    }
+    if (comparefile && !dohelp) return lander::compare_main(comparefile, Opts, nthreads, threshold, compare_turns);
+    if (servesocket && !dohelp) return lander::serve_main(servesocket, Opts, nthreads);
+    if (querysocket && !dohelp) return lander::query_main(querysocket);
+    if (solvefile && !dohelp) return lander::solve_main(solvefile, Opts, nthreads, solve_options);
+    if (optimizefile && !dohelp) return lander::optimize_main(optimizefile, Opts, nthreads, solve_options);
+    if (policyfile && !dohelp) return lander::policy_main(policyfile, Opts, nthreads, policy_options);
+    if (batchfile && !dohelp) return lander::batch_main(batchfile, Opts, nthreads, stats_format, (size_t)(cache_mb * (1 << 20)));
     RedirectedInput = !_isatty(_fileno(stdin));
     if (RedirectedInput) echo_input = true;
+    if (csv) quiet = true;
+    if (quiet) echo_input = false;
+    const bool rows_out = !quiet;  // turn rows, prompts and the other chatter
+    if (trajectoryfile && !dohelp && !trajectory.open(trajectoryfile, Opts))
+    { fprintf(stderr, "Cannot write trajectory file %s\n", trajectoryfile); return 1; }
 
-    puts("CONTROL CALLING LUNAR MODULE. MANUAL CONTROL IS NECESSARY");
-    puts("YOU MAY RESET FUEL RATE FR EACH 10 SECS TO 0 OR ANY VALUE");
-    puts("BETWEEN 8 & 200 LBS/SEC. YOU'VE 16000 LBS FUEL. ESTIMATED");
-    puts("FREE FALL IMPACT TIME-120 SECS. CAPSULE WEIGHT-32500 LBS\n\n");
+    if (rows_out || dohelp)
+    {
+        out.line("CONTROL CALLING LUNAR MODULE. MANUAL CONTROL IS NECESSARY");
+        out.line("YOU MAY RESET FUEL RATE FR EACH 10 SECS TO 0 OR ANY VALUE");
+        out.line("BETWEEN 8 & 200 LBS/SEC. YOU'VE 16000 LBS FUEL. ESTIMATED");
+        out.line("FREE FALL IMPACT TIME-120 SECS. CAPSULE WEIGHT-32500 LBS\n\n");
+    }
     if (dohelp)
     {
         telwhat(argv[0]);
         return 0;
     }
+    if (csv) out.line("game,time,impact_mph,fuel_left,landing,calc,fuel_out_time");
+    int game = 0;
     do // 01.20 in original FOCAL code
     {
-        puts("FIRST RADAR CHECK COMING UP\n\n");
-        puts("COMMENCE LANDING PROCEDURE");
-        puts("TIME,SECS   ALTITUDE,MILES+FEET   VELOCITY,MPH   FUEL,LBS   FUEL RATE");
-
-        A = 120;
-        V = 1;
-        M = 32500;
-        EmptyMass = 16500;
-        G = .001;
-        SpecThrust = 1.8;
-        T = 0;
-
-    start_turn: // 02.10 in original FOCAL code
-        printf("%7.0f%16.0f%7.0f%15.2f%12.1f      ", T, trunc(A), 5280 * (A - trunc(A)), 3600 * V, Fuel);
-        ++turn;
-
-    prompt_for_k:
-        fputs("FR:=", stdout);
-        const auto accepted = accept_double(&FR);
-        if (!accepted || FR < 0 || (0 < FR && FR < 8) || FR > 200)
-        { fputs("NOT POSSIBLE", stdout); for (int x = 1; x <= 51; ++x) putchar('.'); goto prompt_for_k; }
-        if (RedirectedInput) putchar('\n');
-
-        TimeRemain = 10;
-
-    //turn_loop:
-        for (int il31 = 0;;++il31) // 03.10 in original FOCAL code
+        if (rows_out)
         {
-            if (Fuel < .001) goto fuel_out;
-            if (TimeRemain < .001) goto start_turn;
-            // Additional output coming in well when having a flyoff or, contrarily, a landing when close to ground.
-            if (il31) printf("%11.3f%12.0f%+7.0f%15.2f%12.1f      FR  %.6lf\n", T, trunc(A), 5280 * (A - trunc(A)), 3600 * V, Fuel, FR);
-            TF = TimeRemain;
-            if (TF * FR > Fuel) TF = Fuel / FR;
-
-            apply_thrust();
-
-            if (EndAlt <= 0)
-                goto loop_until_on_the_moon;
-
-            if (V > 0 && EndSpeed < 0)
-            {   // can only get here with power (FR) during the landing turn resulting in negative acceleration.
-                for (int il81 = 0;;++il81) // 08.10 in original FOCAL code
-                {
-                    // FOCAL-to-C gotcha: In FOCAL, multiplication has a higher // precedence than division.
-                    // In C, they have the same precedence and are evaluated left-to-right.
-                    // So the original FOCAL subexpression `M * G / SpecThrust * FR` can't be copied as-is
-                    // into C: `SpecThrust * FR` has to be parenthesized to get the same result.
-
-                    // TF becomes time to zero speed -> time to lowest point given the motion direction reversal.
-                    // you might try with the simplest estimate of TF for V == 0
-                    // const auto acc = G - SpecThrust * FR / M;
-                    // TF = -V / acc;    // which really comes out too high, overshoot, no obvious iteration available.
-                    X = 0.5 * (1 - M * G / (SpecThrust * FR));
-#                 ifdef _DEBUG
-                    // precalculate TF according to the old formula for comparison to bugfix and other attempts
-                    // You may want to leave out the addition of 0.05 sec, or apply it also in the bugfix.
-                    TF = M * V / (SpecThrust * FR * (X + sqrt(X * X + V / SpecThrust))) + 0.05;
-#                 else
-                    if (CalcMethod == ORIGINAL) TF = M * V / (SpecThrust * FR * (X + sqrt(X * X + V / SpecThrust))) + 0.05;
-#                 endif
-                    if (CalcMethod == BUGFIXED)   // if modern, overwrite TF with corrected formula
-                    {
-#                     ifdef _DEBUG
-                        // try other solution. Didn't work sofar, consider deprecated.
-                        TF = M * V / (SpecThrust * FR * (X - sqrt(X * X + 0.5 * V / SpecThrust)));
-#                     endif
-                        TF = M * V / (SpecThrust * FR * (X + sqrt(X * X + 0.5 * V / SpecThrust)));
-                    }
-                    else if (CalcMethod == EXACT)
-                         TF = brent::zero(0, TF, 1e-9, getalt);		// 3rd parameter is tolerance.
-
-                    apply_thrust();
-                    // choose between original <= 0 or <= small value which may lead to a good landing instead of an flyoff.
-                    if (EndAlt <= maxdropheightft / 5280.)
-                    {   // a perfect landing to be expected by turning of the engine at (very) low EndAlt.
-                        // This also relieves small inaccuracies in the TF calculation.
-                        update_lander_state();
-                        if (!il31) printf("%11.3f%12.0f%+7.1f%15.2f%12.1f      FR  %.6lf\n", T, trunc(A), 5280 * (A - trunc(A)), 3600 * EndSpeed, Fuel, FR);
-                        if (EndAlt >= 0)     // but smaller than or equal to maxdropheight
-                        {
-                            // loop_until_on_the_moon may fail to converge (really a marginal fly-off).
-                            TF = sqrt(2 * EndAlt / G);
-                            V = EndSpeed = TF * G;
-                            A = EndAlt = 0;
-                            T += TF;
-                            goto on_the_moon;
-                        }
-                        goto loop_until_on_the_moon; // lowest point under surface, find conditions when hitting ground.
-                    }
-                    update_lander_state();
-                    // this condition is confused. May be the EndSpeed test should be done before update_lander_state()
-                    // The EndSpeed and V comparisons are separate in the original code 8.30 (J and V).
-                    //if (EndSpeed > 0 || V <= 0) goto turn_loop;     // V is set equal to EndSpeed in update_lander_state() ?!!
-                    //if (EndSpeed > 0 || V <= 0) break;     // to continue the 3.10 loop, with loopcounter increased, not reset.
-                    // if time has not run out, we want to repeat the search for negative altitude rather than repeating apply_thrust()
-                    if (TimeRemain < 0.001 || V <= 0) break;  // force reading a new input if time has run out and apply_thrust() anyway.
-                }
-                continue;       // avoids update_lander_state() (again). Used to be goto turn_loop, now loop with counter.
-            }
-            update_lander_state();
+            out.line("FIRST RADAR CHECK COMING UP\n\n");
+            out.line("COMMENCE LANDING PROCEDURE");
+            out.line("TIME,SECS   ALTITUDE,MILES+FEET   VELOCITY,MPH   FUEL,LBS   FUEL RATE");
         }
-        // The way here appears to be: make an estimate without mass change (apply_thrust), then apply_thrust and
-        // hopefully not keep undershooting the surface. The equation is 0.5Gt2 + Vt = altitude (to be lost),
-        // Some have mentioned a possible numerical problem (catastrophic cancellation).
-        // I've added a robust quadratic solver, after which I cannot yet conclude to any such problem,
-        // but given the sometimes very low and close values, it is certainly possible.
-        // See https://en.wikipedia.org/wiki/Quadratic_formula#Square_root_in_the_denominator and note 22.
-        // A potential improvement is to check whether start or finish altitude of the turn is closer to zero
-        // to minimize the approximation effort, but it does not appear needed.
-    loop_until_on_the_moon: // 07.10 in original FOCAL code
-        while (TF >= .005)
-        {   // calculate time from level zero to underground (A), reduce speed (marginal), update (landing)time, mass.
-            std::array<double, 2> roots;
-            // TF should be pretty much equal to 5 or 6 digits or more in various way of calculating it.
-            // original formula, ok and still effectively used after precalculating acceleration and discriminant.
-            // TF = 2 * A / (V + sqrt(V * V + 2 * A * (G - SpecThrust * FR / M)));
-            const auto acc = G - SpecThrust * FR / M, disc = sqrt(V * V + 2 * A * acc);
-            TF = (disc - V) / acc;  // usual formula. See whether numerator and denominator root choice may differ explaining choice.
-#         ifdef _DEBUG
-            const auto tf = 2 * A / (disc + V);     // equivalent to commented original formula
-            if (tf != TF && fabs(tf - TF) > 1e-9) fprintf(stderr, "%.10lf vs %.10lf\n", tf, TF);
-#         endif
-            TF = 2 * A / (disc + V); // discriminant in denominator. This is expected to be consistently right.
-            // If we calculate undershoot correction, A should be positive -> negative in quadratic equation (sidechange).
-            if (CalcMethod == EXACT && quadratic(roots, 0.5 * acc, V, -A))     // return false in case of no real root(s)
-                TF = roots[roots[0] < 0];
-            if (TF > 0) apply_thrust();
-            else if (TF < 0) { EndSpeed += TF * acc; EndAlt = 0; TF = 0; }  // not expected.
-            update_lander_state();
+        ++game;
+        FR = 0;
+#     ifdef LANDER_STATS
+        lander::stats = lander::Stats{};
+#     endif
+        // the game runs in a session (session.hpp), as the games of --serve do: it stops at every
+        // prompt with the rows up to it, and the fuel rate resumes it.
+        lander::GameSession session(Opts);  // 01.50 in original FOCAL code
+        const lander::LanderState& L = session.lander();
+
+    start_turn: // 02.10 in original FOCAL code, after the rows of the turn before
+        if (rows_out)
+            for (const lander::TrajectoryRecord& r : session.rows()) print_row(r);
+        if (trajectory.is_open()) trajectory.rows(session.rows());
+        if (!session.landed())
+        {
+            ++turn;
+        prompt_for_k:
+            if (rows_out) out.text("FR:=");
+            // --autopilot: the table answers for the player, stdin is not read.
+            const auto accepted = autopilot.is_open() ? (FR = autopilot.rate(L, Opts), true) : accept_double(&FR);
+            if (!accepted || !lander::valid_fuel_rate(FR))
+            { if (rows_out) out.text("NOT POSSIBLE").fill('.', 51); goto prompt_for_k; }
+            if (autopilot.is_open() && rows_out) out.shortest(FR);
+            if ((RedirectedInput || autopilot.is_open()) && rows_out) out.put('\n');
+            if (trajectory.is_open()) trajectory.start_turn(L, FR);
+            session.resume(FR);     // 03.10 to 09.40 in original FOCAL code, 04.10 when the fuel runs out
+            goto start_turn;
         }
-        goto on_the_moon;
 
-    fuel_out: // 04.10 in original FOCAL code
-        printf("\nFUEL OUT AT %8.2f SECS\n", T);
-        TF = (sqrt(V * V + 2 * A * G) - V) / G;
-        V += G * TF;
-        T += TF;
-
-    on_the_moon: // 05.10 in original FOCAL code
-        printf("\nON THE MOON AT   %8.3f SECS\n", T);
-        X = 3600 * V;
-        printf("IMPACT VELOCITY: %8.3f M.P.H.\n", X);
-        printf("FUEL LEFT:       %8.2f LBS\n", Fuel);
-        if (X <= 1) puts("PERFECT LANDING !-(LUCKY)");
-        else if (X <= 10) puts("GOOD LANDING-(COULD BE BETTER)");
-        else if (X <= 22) puts("CONGRATULATIONS ON A POOR LANDING");
-        else if (X <= 40) puts("CRAFT DAMAGE. GOOD LUCK");
-        else if (X <= 60) puts("CRASH LANDING-YOU'VE 5 HRS OXYGEN");
-        else
+        // on_the_moon: 05.10 in original FOCAL code
+        const double X = 3600 * L.V;
+        const double fuel_out_T = session.result().fuel_out_T;
+        if (csv)
+        {   // the columns of --batch, with the game instead of the line.
+            out.integer(game).put(',').shortest(L.T).put(',').shortest(X).put(',').shortest(L.fuel()).put(',')
+                .text(lander::landingclass_name(lander::classify(X))).put(',').text(calcmess).put(',').shortest(fuel_out_T)
+                .put('\n');
+            continue;
+        }
+        out.text("\nON THE MOON AT   ").fixed(L.T, 8, 3).line(" SECS");
+        out.text("IMPACT VELOCITY: ").fixed(X, 8, 3).line(" M.P.H.");
+        out.text("FUEL LEFT:       ").fixed(L.fuel(), 8, 2).line(" LBS");
+        switch (lander::classify(X))
         {
-            puts("SORRY,BUT THERE WERE NO SURVIVORS-YOU BLEW IT!");
-            printf("IN FACT YOU BLASTED A BUGFIXED LUNAR CRATER %8.2f FT. DEEP\n", X * .277777);
+        case lander::PERFECT: out.line("PERFECT LANDING !-(LUCKY)"); break;
+        case lander::GOOD: out.line("GOOD LANDING-(COULD BE BETTER)"); break;
+        case lander::POOR: out.line("CONGRATULATIONS ON A POOR LANDING"); break;
+        case lander::DAMAGE: out.line("CRAFT DAMAGE. GOOD LUCK"); break;
+        case lander::CRASH: out.line("CRASH LANDING-YOU'VE 5 HRS OXYGEN"); break;
+        default:
+            out.line("SORRY,BUT THERE WERE NO SURVIVORS-YOU BLEW IT!");
+            out.text("IN FACT YOU BLASTED A BUGFIXED LUNAR CRATER ").fixed(X * .277777, 8, 2).line(" FT. DEEP");
         }
 
-        if (!dohelp) printf("(Calculated using the %s version for time to lowest point (zero speed))\n", calcmess);
-        if (!RedirectedInput) puts("\nTRY AGAIN?"); else putchar('\n');
+        if (!dohelp) out.text("(Calculated using the ").text(calcmess).line(" version for time to lowest point (zero speed))");
+#     ifdef LANDER_STATS
+        out.flush();
+        lander::write_stats(stdout, lander::stats, stats_format);
+#     endif
+        if (!rows_out) continue;
+        if (!RedirectedInput) out.line("\nTRY AGAIN?"); else out.put('\n');
     } while (accept_yes_or_no() == 1);
 
-    puts("CONTROL OUT");
+    if (rows_out) out.line("CONTROL OUT");
+    out.flush();
+    trajectory.close();
     waitkey();
     return 0;
 }
 
-// Subroutine at line 06.10 in original FOCAL code
-static void update_lander_state()
-{
-    T += TF;
-    TimeRemain -= TF;
-    M -= TF * FR;
-    A = EndAlt;
-    V = EndSpeed;
-}
-
-// Subroutine at line 09.10 in original FOCAL code
-static void apply_thrust()
-{
-    const double Q = TF * FR / M, Q_2 = Q * Q, Q_3 = Q_2 * Q, Q_4 = Q_3 * Q, Q_5 = Q_4 * Q;
-
-    const double endspeedExact = V + G * TF + SpecThrust * log(1 - Q);        // exact, for comparison
-    // Using Taylor expansion, NB deltax is negative -> terms get the same sign, no sign altercation:
-    EndSpeed = V + G * TF + SpecThrust * (-Q - Q_2 / 2 - Q_3 / 3 - Q_4 / 4 - Q_5 / 5);
-    double endaltExact = A - G * TF * TF / 2 - V * TF;
-    if (Q > 0)
-    {
-        const auto a = FR / M;
-        // a bit of simpson to integrate to distance (altitude) increase.
-        //auto lfunc = [a](const double t) { return log(1 - a * t); };
-        //const auto y = simpson_rule<double, decltype(lfunc)>(0., TF, 10, lfunc);
-        const auto z = (TF - 1 / a) * log(1 - Q) - TF;
-        endaltExact -= SpecThrust * z;       // exact.
-    }
-    // Taylor expansion integrated (t = 0 to TF), sum dA for gravity, starting speed and engine.
-    EndAlt = A - G * TF * TF / 2 - V * TF + SpecThrust * TF * (Q / 2 + Q_2 / 6 + Q_3 / 12 + Q_4 / 20 + Q_5 / 30);
-    if (CalcMethod == EXACT) { EndSpeed = endspeedExact; EndAlt = endaltExact; }
-}
-
 // Read a floating-point value from stdin.
 // Returns 1 on success, or 0 if input did not contain a number.
 // Calls exit(-1) on EOF or other failure to read input.
 static bool accept_double(double *value)
 {
-    char *buffer = NULL;
-    int buffer_length = 0;
-    if (accept_line(&buffer, &buffer_length))
-    {
-        int is_valid_input = sscanf(buffer, "%lf", value);
-        free(buffer);
-        return is_valid_input == 1;
-    }
-    else if (RedirectedInput) { value = 0; return true; }
-    return false;
+    size_t length;
+    if (const char* line = accept_line(&length))
+        return lander::parse_double(line, line + length, *value) != nullptr;
+    // at the end of redirected input the last value is kept.
+    return RedirectedInput;
 }
 
 // Reads input and returns 1 if it starts with 'Y' or 'y', or returns 0 if it
 // starts with 'EmptyMass' or 'n'.
 // If input starts with none of those characters, prompt again.
 // If unable to read input, calls exit(-1);
+// Redirected input is not prompted: the fuel rates this game did not use are skipped up to the
+// delimiter of the next game (1), up to a NO line or to the end of the input (0).
+// A delimiter at the very end starts no game.
 static int accept_yes_or_no()
 {
-    if (RedirectedInput) return 0;
+    if (RedirectedInput)
+    {
+        if (game_input_ended) { game_input_ended = false; return !input.at_end(); }
+        while (const char* line = input.next())
+        {
+            if (is_game_delimiter(line)) return !input.at_end();
+            if (line[0] == 'n' || line[0] == 'N') return 0;
+        }
+        return 0;
+    }
     int result = -1;
     do
     {
-        fputs("(ANS. YES OR NO):", stdout);
-        char *buffer = NULL;
-        int buffer_length = 0;
-        if (!accept_line(&buffer, &buffer_length)) return -1;
+        out.text("(ANS. YES OR NO):");
+        const char* buffer = accept_line();
+        if (!buffer) return -1;
 
-        if (buffer_length > 0)
+        switch (buffer[0])
         {
-            switch (buffer[0])
-            {
-            case 'y':
-            case 'Y':
-            case 'j':
-            case 'J':
-                result = 1;
-                break;
-            case 'n':
-            case 'N':
-                result = 0;
-                break;
-            default:
-                break;
-            }
+        case 'y':
+        case 'Y':
+        case 'j':
+        case 'J':
+            result = 1;
+            break;
+        case 'n':
+        case 'N':
+            result = 0;
+            break;
+        default:
+            break;
         }
-
-        free(buffer);
     } while (result < 0);
-    putchar('\n');
+    out.put('\n');
     return result;
 }
 
-static int getline(char** buffer, int* buflen, FILE* stream)
-{
-    // Zie https ://stackoverflow.com/questions/58670828/is-there-a-way-to-rewind-stdin-in-c. stdin niet seekable.
-    if (!stream || feof(stream) || !buffer || !buflen) return -1;
-    int bufsiz = 256;
-    *buffer = (char*)malloc(bufsiz);
-    if (!*buffer) return -1;
-    char* ptr = fgets(*buffer, bufsiz, stream);
-    *buflen = 0;
-    if (!ptr) return -1;
-    else if (!*ptr) return 0;
-    return *buflen = (int)strlen(*buffer);
-    //return *buflen < bufsiz 1 || (*buffer)[*buflen 1] == '\n' ? *buflen : -1;
-}
-
 static void waitkey()
 {   // ideally, use parent-process (or similar means) to know whether the window will be closed on exit,
     // loosing the output before it can be inspected;
@@ -508,16 +482,25 @@ static void waitkey()
     { int r; fputs("Press a key", stderr); while (_kbhit()) r=_getch(); r=_getch(); }
 }
 
-// Reads a line of input.  Caller is responsible for calling free() on the returned buffer.
-// If unable to read input, calls exit(-1).
-static bool accept_line(char **buffer, int *buffer_length)
+// Reads a line of input, without trailing white space, into the buffer of one LineReader for the whole game.
+// Valid until the next line is read. Returns nullptr at the end of the input, and for redirected
+// input also at the delimiter of the next game, until accept_yes_or_no() starts it.
+static const char* accept_line(size_t *length)
+{
+    if (game_input_ended) return nullptr;
+    if (!RedirectedInput) out.flush();     // show the prompt
+    const char* line = input.next(length);
+    if (!line)
+    { fputs("\nEND OF INPUT\n", stderr); return nullptr; }
+    if (RedirectedInput && is_game_delimiter(line))
+    { game_input_ended = true; return nullptr; }
+    if (echo_input) out.text(line);
+    return line;
+}
+
+static bool is_game_delimiter(const char* line)
 {
-    if (getline(buffer, buffer_length, stdin) == -1)
-    { fputs("\nEND OF INPUT\n", stderr); return false; }
-    auto e = strlen(*buffer);
-    while (e > 0 && isspace((*buffer)[--e])) (*buffer)[e] = 0;
-    if (echo_input) fputs(*buffer,stdout);
-    return true;
+    return (line[0] && strchr("yYjJ", line[0])) || !strncmp(line, "---", 3);
 }
 
 /*
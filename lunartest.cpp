@@ -0,0 +1,372 @@
+// Checks of what the optimized paths promise: the batched structure-of-arrays physics gives what
+// LanderState gives, lane for lane and bit for bit; simd::log1p stays within its error bound; the
+// lockstep brent::zero_batch finds the zeros brent::zero finds one by one. The server answers a query
+// sent in pieces, keeps a game going across them, gets a burst of replies out through partial sends, and
+// refuses R states it could not land.
+// Every check prints ok or FAILED with what differs; the exit code is the number of failed checks.
+// Not part of the game, build it on its own (with -mavx2 or -mavx512f as well, to check the vector lanes):
+//    cl /O2 /EHsc lunartest.cpp lander.cpp lander_soa.cpp brent.cpp server.cpp session.cpp batch.cpp input.cpp
+//       trajectory.cpp threadpool.cpp prefixcache.cpp stats.cpp
+//    g++ -O2 -ffp-contract=off -pthread lunartest.cpp lander.cpp lander_soa.cpp brent.cpp server.cpp session.cpp
+//       batch.cpp input.cpp trajectory.cpp threadpool.cpp prefixcache.cpp stats.cpp -o lunartest
+// usage: lunartest [name filter]
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+ #include <winsock2.h>
+ #include <afunix.h>
+ #pragma comment(lib, "Ws2_32.lib")
+#else
+ #include <sys/socket.h>
+ #include <sys/un.h>
+ #include <unistd.h>
+#endif
+#include "brent.hpp"
+#include "lander.hpp"
+#include "lander_soa.hpp"
+#include "session.hpp"
+#include "server.hpp"
+#include "simd.hpp"
+
+#ifdef _WIN32
+typedef SOCKET socket_t;
+static const socket_t no_socket = INVALID_SOCKET;
+static void close_socket(socket_t s) { closesocket(s); }
+#else
+typedef int socket_t;
+static const socket_t no_socket = -1;
+static void close_socket(socket_t s) { close(s); }
+#endif
+
+static const char* filter = nullptr;
+static int failed = 0;
+
+// run check() if its name passes the filter. It returns false on failure, after printing why.
+template <typename F>
+static void check(const char* name, F&& check)
+{
+    if (filter && !strstr(name, filter)) return;
+    const bool ok = check();
+    printf("%-40s %s\n", name, ok ? "ok" : "FAILED");
+    if (!ok) ++failed;
+}
+
+static bool same_bits(double a, double b) { return memcmp(&a, &b, sizeof(a)) == 0; }
+
+// landers anywhere in the game's range, a tenth of them coasting (FR 0).
+static void random_landers(size_t n, unsigned seed, std::vector<lander::LanderState>& landers)
+{
+    std::mt19937_64 random(seed);
+    std::uniform_real_distribution<double> A(0, 120), V(-0.3, 1.3), M(16500, 32500), FR(8, 200), TF(0.001, 10);
+    landers.resize(n);
+    for (lander::LanderState& L : landers)
+    {
+        L.A = A(random); L.V = V(random); L.M = M(random);
+        L.FR = random() % 10 ? FR(random) : 0;
+        L.TF = TF(random);
+        if (L.TF * L.FR > L.fuel()) L.TF = L.fuel() / L.FR;
+        L.T = 10 * (double)(random() % 40);
+        L.TimeRemain = 10;
+    }
+}
+
+// apply_thrust() and update_lander_state() of 100000 landers, batched against one at a time.
+static bool soa_matches_scalar()
+{
+    std::vector<lander::LanderState> landers;
+    random_landers(100000, 3, landers);
+    bool ok = true;
+    for (int m = lander::ORIGINAL; m <= lander::EXACT; ++m)
+    {
+        const lander::calcmethod method = (lander::calcmethod)m;
+        lander::LanderSoA soa;
+        soa.resize(landers.size());
+        for (size_t i = 0; i < landers.size(); ++i) soa.set(i, landers[i]);
+        lander::apply_thrust(soa, method);
+        lander::update_lander_state(soa);
+        size_t wrong = 0;
+        for (size_t i = 0; i < landers.size(); ++i)
+        {
+            lander::LanderState L = landers[i], B;
+            L.apply_thrust(method);
+            L.update_lander_state();
+            soa.get(i, B);
+            const bool same = same_bits(L.EndAlt, B.EndAlt) && same_bits(L.EndSpeed, B.EndSpeed) && same_bits(L.A, B.A)
+                && same_bits(L.V, B.V) && same_bits(L.M, B.M) && same_bits(L.T, B.T) && same_bits(L.TimeRemain, B.TimeRemain);
+            if (!same && wrong++ == 0)
+                printf("  %s lander %zu: EndAlt %.17g / %.17g, EndSpeed %.17g / %.17g\n", lander::calcmethod_name(method),
+                    i, L.EndAlt, B.EndAlt, L.EndSpeed, B.EndSpeed);
+        }
+        if (wrong) { printf("  %s: %zu of %zu landers differ\n", lander::calcmethod_name(method), wrong, landers.size()); ok = false; }
+    }
+    return ok;
+}
+
+// error of simd::log1p in ulps against log1pl: over the arguments of the game, log1p(-Q) with Q from 0
+// to the 0.121 of a full turn at 200 lbs/s with the tanks near empty (and the larger t FR / M of the
+// solvers), tiny ones, and the whole domain (-1, 1e6). The vector lanes must give the same bits.
+// Needs a long double wider than double (gcc and clang on x86); MSVC's is not, the check is skipped.
+static bool log1p_within_bound()
+{
+    if (sizeof(long double) <= sizeof(double)) { printf("  long double is double, skipped\n"); return true; }
+    std::mt19937_64 random(4);
+    std::vector<double> x;
+    for (int i = 0; i <= 200000; ++i) x.push_back(-0.5 * i / 200000);
+    std::uniform_real_distribution<double> exponent(-300, -1), unit(0, 1), wide(-1, 6);
+    for (int i = 0; i < 200000; ++i)
+    {
+        const double tiny = pow(10, exponent(random));
+        x.push_back(i & 1 ? tiny : -tiny);
+        const double w = wide(random);
+        x.push_back(w < 0 ? -unit(random) * 0.9999999 : pow(10, w) - 1);
+    }
+    std::vector<double> batch(x.size());
+    size_t i = 0;
+#if defined(__AVX512F__) || defined(__AVX2__)
+    for (const size_t w = simd::native::width; i + w <= x.size(); i += w)
+        simd::store(&batch[i], simd::log1p(simd::load(&x[i], simd::native())));
+#endif
+    for (; i < x.size(); ++i) batch[i] = simd::log1p(x[i]);
+    double worst = 0, worst_x = 0;
+    size_t lanes_differ = 0;
+    for (i = 0; i < x.size(); ++i)
+    {
+        const double y = simd::log1p(x[i]);
+        if (!same_bits(y, batch[i])) ++lanes_differ;
+        const long double exact = log1pl((long double)x[i]);
+        if (exact == 0) { if (y != 0) { worst = HUGE_VAL; worst_x = x[i]; } continue; }
+        const double r = fabs((double)exact), ulp = nextafter(r, HUGE_VAL) - r;
+        const double err = (double)(fabsl((long double)y - exact) / ulp);
+        if (err > worst) { worst = err; worst_x = x[i]; }
+    }
+    printf("  %zu arguments, worst %.3f ulp at %.17g\n", x.size(), worst, worst_x);
+    if (lanes_differ) printf("  %zu vector lanes differ from the scalar instance\n", lanes_differ);
+    return worst < 0.85 && lanes_differ == 0;
+}
+
+// altitude_zero() (brent::zero_batch on the vectorized getalt) against brent::zero on LanderState::getalt,
+// per lander: the same touchdown time within the tolerance, and no zero where getalt() keeps its sign.
+static bool zero_batch_matches_zero()
+{
+    std::vector<lander::LanderState> landers;
+    random_landers(20000, 6, landers);
+    lander::LanderSoA soa;
+    soa.resize(landers.size());
+    for (size_t i = 0; i < landers.size(); ++i)
+    {   // low and burning, so that about half of them touch down within TF.
+        lander::LanderState& L = landers[i];
+        L.A *= 0.001;
+        if (L.FR == 0) L.FR = 100;
+        L.TF = 10;
+        if (L.TF * L.FR > L.fuel()) L.TF = L.fuel() / L.FR;
+        soa.set(i, L);
+    }
+    const double tol = 1e-9;
+    std::vector<double> t(landers.size());
+    std::vector<int> status(landers.size());
+    lander::altitude_zero(soa, tol, t.data(), status.data());
+    size_t zeros = 0, wrong = 0;
+    for (size_t i = 0; i < landers.size(); ++i)
+    {
+        const lander::LanderState& L = landers[i];
+        const bool sign_change = L.getalt(0) * L.getalt(L.TF) <= 0;
+        bool ok;
+        if (sign_change)
+        {
+            ++zeros;
+            const double one = brent::zero(0, L.TF, tol, [&L](double x) { return L.getalt(x); });
+            ok = status[i] == 0 && fabs(t[i] - one) <= 4 * (tol + 1e-15 * L.TF);
+        }
+        else ok = status[i] < 0 && std::isnan(t[i]);
+        if (!ok && wrong++ == 0)
+            printf("  lander %zu: %s, batch %.17g status %d\n", i, sign_change ? "zero" : "no zero", t[i], status[i]);
+    }
+    printf("  %zu landers, %zu touch down within TF, %zu differ\n", landers.size(), zeros, wrong);
+    return wrong == 0 && zeros > 0;
+}
+
+static const char* socket_path = "lunartest.sock";
+
+// a connection to the server of the tests, started on a thread of its own the first time. It runs
+// until the process ends.
+static socket_t connect_server()
+{
+    static bool started = false;
+    if (!started)
+    {
+#     ifdef _WIN32
+        WSADATA data;
+        WSAStartup(MAKEWORD(2, 2), &data);
+#     endif
+        lander::Options opt;
+        opt.CalcMethod = lander::EXACT;
+        std::thread([opt] { lander::serve_main(socket_path, opt, 2); }).detach();
+        started = true;
+    }
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    for (int tries = 0; tries < 500; ++tries)
+    {   // until it listens
+        const socket_t s = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (s == no_socket) return no_socket;
+        if (connect(s, (const sockaddr*)&addr, sizeof(addr)) == 0)
+        {   // a reply that does not come fails the check instead of hanging it.
+#         ifdef _WIN32
+            const DWORD timeout = 10000;
+#         else
+            const timeval timeout{ 10, 0 };
+#         endif
+            setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+            return s;
+        }
+        close_socket(s);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return no_socket;
+}
+
+static bool send_all(socket_t s, const std::string& text)
+{
+    for (size_t sent = 0; sent < text.size();)
+    {
+        const int n = (int)send(s, text.data() + sent, (int)(text.size() - sent), 0);
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+// the reply lines up to the n-th, without their line ends.
+static bool receive_lines(socket_t s, size_t n, std::vector<std::string>& lines)
+{
+    std::string received;
+    char chunk[4096];
+    lines.clear();
+    while (lines.size() < n)
+    {
+        size_t eol;
+        while ((eol = received.find('\n')) != std::string::npos && lines.size() < n)
+        {
+            lines.push_back(received.substr(0, eol));
+            received.erase(0, eol + 1);
+        }
+        if (lines.size() == n) break;
+        const int k = (int)recv(s, chunk, sizeof(chunk), 0);
+        if (k <= 0) return false;
+        received.append(chunk, k);
+    }
+    return true;
+}
+
+static std::string expected_reply(const char* request, lander::GameSession* game = nullptr)
+{
+    lander::Options opt;
+    opt.CalcMethod = lander::EXACT;
+    std::string reply;
+    lander::answer_query(request, request + strlen(request), opt, reply, game);
+    return reply;
+}
+
+// a landing and a game, each request sent a few bytes at a time with pauses between, so that the
+// server sees them in pieces over several polls; the game must carry on from one to the next.
+static bool server_split_writes()
+{
+    const socket_t s = connect_server();
+    if (s == no_socket) { printf("  cannot connect to %s\n", socket_path); return false; }
+    static const char* requests[] = { "L 0 0 0 0 0 0 0 164.31426785 200 200 200 200 200 200 200 200 200",
+        "N calc=exact", "F 0", "F 0", "F 200", "L calc=bugfixed 0 0 0 0 0 0 0 170 200 200 200 200 200" };
+    lander::GameSession game;
+    bool ok = true;
+    for (const char* request : requests)
+    {
+        const std::string line = std::string(request) + '\n';
+        for (size_t i = 0; i < line.size(); i += 5)
+        {
+            if (!send_all(s, line.substr(i, 5))) { printf("  send failed\n"); close_socket(s); return false; }
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        std::vector<std::string> reply;
+        if (!receive_lines(s, 1, reply)) { printf("  no reply to %s\n", request); close_socket(s); return false; }
+        const std::string expected = expected_reply(request, &game);
+        if (reply[0] != expected)
+        {
+            printf("  %s:\n    got      %.100s\n    expected %.100s\n", request, reply[0].c_str(), expected.c_str());
+            ok = false;
+        }
+    }
+    close_socket(s);
+    return ok;
+}
+
+// thousands of requests in one go, read only once all are sent: the replies are far more than the
+// socket buffer holds, so the server sends them in parts over many polls. All must arrive, in order.
+static bool server_partial_sends()
+{
+    const socket_t s = connect_server();
+    if (s == no_socket) { printf("  cannot connect to %s\n", socket_path); return false; }
+    const size_t n = 20000;
+    std::string burst;
+    std::vector<std::string> requests(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        char text[100];
+        snprintf(text, sizeof(text), "L 0 0 0 0 0 0 0 %.6f 200 200 200 200 200 200 200 200 200", 160 + i * 0.0005);
+        requests[i] = text;
+        burst.append(text).push_back('\n');
+    }
+    std::vector<std::string> replies;
+    bool ok = true;
+    std::thread reader([&] { ok = receive_lines(s, n, replies); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));     // let the replies pile up first
+    ok = send_all(s, burst) && ok;
+    reader.join();
+    close_socket(s);
+    if (!ok) { printf("  connection lost after %zu of %zu replies\n", replies.size(), n); return false; }
+    size_t wrong = 0, bytes = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        bytes += replies[i].size() + 1;
+        if (replies[i] != expected_reply(requests[i].c_str()) && wrong++ == 0)
+            printf("  reply %zu: %.100s\n", i, replies[i].c_str());
+    }
+    printf("  %zu replies, %zu bytes, %zu wrong\n", n, bytes, wrong);
+    return wrong == 0;
+}
+
+// R with states nothing lands from in reasonable time, or a turn count past int32_t, is refused.
+static bool server_refuses_absurd_states()
+{
+    static const char* absurd[] = { "R 1e300 0 32500 0 0 0", "R -1 0 32500 0 0 0", "R 120 1e6 32500 0 0 0",
+        "R 120 -1e6 32500 0 0 0", "R 120 1 1e9 0 0 0", "R 120 1 100 0 0 0", "R 120 1 32500 0 3e9 0" };
+    bool ok = true;
+    for (const char* request : absurd)
+    {
+        const std::string reply = expected_reply(request);
+        if (reply.compare(0, 6, "error ")) { printf("  %s: %s\n", request, reply.c_str()); ok = false; }
+    }
+    const std::string reply = expected_reply("R 120 1 32500 0 0 0");
+    if (reply.compare(0, 3, "ok ")) { printf("  the start: %s\n", reply.c_str()); ok = false; }
+    return ok;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1) filter = argv[1];
+    printf("lunartest: %s\n", simd::isa());
+    check("soa/apply_thrust matches LanderState", soa_matches_scalar);
+    check("log1p/below 0.85 ulp", log1p_within_bound);
+    check("zero_batch/matches brent::zero", zero_batch_matches_zero);
+    check("server/query in pieces", server_split_writes);
+    check("server/partial sends", server_partial_sends);
+    check("server/R refuses absurd states", server_refuses_absurd_states);
+    remove(socket_path);
+    return failed;
+}
@@ -0,0 +1,62 @@
+// Buffered output, see output.hpp.
+#include <stdio.h>
+#include <string.h>
+#include <charconv>
+#include <cmath>
+#include "output.hpp"
+
+namespace lander {
+
+// room for a number: %f of the largest double has 309 digits before the point.
+static const size_t number_room = 400;
+
+Output& Output::text(const char* s, size_t n)
+{
+    if (used + n > sizeof(buf))
+    {
+        flush();
+        if (n > sizeof(buf)) { fwrite(s, 1, n, out); return *this; }
+    }
+    memcpy(buf + used, s, n);
+    used += n;
+    return *this;
+}
+
+Output& Output::fill(char c, int n)
+{
+    for (; n > 0; --n) put(c);
+    return *this;
+}
+
+Output& Output::fixed(double x, int width, int precision, bool plus)
+{
+    char num[number_room];
+    char* p = num;
+    if (plus && !std::signbit(x)) *p++ = '+';
+    const std::to_chars_result r = std::to_chars(p, num + sizeof(num), x, std::chars_format::fixed, precision);
+    const int n = (int)(r.ptr - num);
+    return fill(' ', width - n).text(num, n);
+}
+
+Output& Output::shortest(double x)
+{
+    char num[number_room];
+    const std::to_chars_result r = std::to_chars(num, num + sizeof(num), x);
+    return text(num, r.ptr - num);
+}
+
+Output& Output::integer(long n)
+{
+    char num[24];
+    const std::to_chars_result r = std::to_chars(num, num + sizeof(num), n);
+    return text(num, r.ptr - num);
+}
+
+void Output::flush()
+{
+    if (used) fwrite(buf, 1, used, out);
+    used = 0;
+    fflush(out);
+}
+
+}
@@ -0,0 +1,38 @@
+// Buffered output for the game: text and numbers are gathered in one buffer and written with fwrite
+// when it is full or flushed, numbers formatted with std::to_chars, which gives the same characters as
+// printf("%*.*f") without parsing a format string per row.
+#pragma once
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace lander {
+
+class Output {
+public:
+    explicit Output(FILE* out) : out(out) {}
+    ~Output() { flush(); }
+    Output(const Output&) = delete;
+    Output& operator=(const Output&) = delete;
+
+    Output& text(const char* s, size_t n);
+    Output& text(const char* s) { return text(s, strlen(s)); }
+    // s and a line end, as puts().
+    Output& line(const char* s = "") { return text(s).put('\n'); }
+    Output& put(char c) { if (used == sizeof(buf)) flush(); buf[used++] = c; return *this; }
+    Output& fill(char c, int n);
+    // x right aligned in width with precision decimals, as printf("%*.*f"); plus also signs positive values ("%+").
+    Output& fixed(double x, int width, int precision, bool plus = false);
+    // the shortest text that reads back as x, for csv.
+    Output& shortest(double x);
+    Output& integer(long n);
+    // write the buffer, before reading input after a prompt and before others write to the same file.
+    void flush();
+
+private:
+    FILE* out;
+    size_t used{ 0 };
+    char buf[1 << 16];
+};
+
+}
@@ -0,0 +1,311 @@
+// Optimal policy table, see policy.hpp.
+#include <math.h>
+#include <cmath>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#ifdef _WIN32
+ #include <Windows.h>
+#else
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+#include "brent.hpp"
+#include "lander.hpp"
+#include "threadpool.hpp"
+#include "policy.hpp"
+
+namespace lander {
+
+static const char policy_magic[8] = { 'L', 'A', 'N', 'D', 'P', 'L', 'C', 'Y' };
+
+// impact velocity (mph) of a free fall from A at V: V^2 + 2 G A at the surface.
+static double free_fall_mph(double A, double V, double G)
+{
+    const double v2 = V * V + 2 * G * A;
+    return 3600 * sqrt(v2 > 0 ? v2 : 0);
+}
+
+// whether the turn from L can end on the moon: thrust only keeps it higher than a free fall.
+static bool can_touch_down(const LanderState& L, const Options& opt)
+{
+    return L.A - 10 * L.V - 50 * L.G <= opt.maxdropheightft / 5280;
+}
+
+// the cost of a turn that does not land, to the searches for the softest touchdown.
+static const double no_touchdown = 1e9;
+
+// one turn from L at fr, L then where it ends. Returns the touchdown speed (mph, up or down), or
+// no_touchdown if the lander is still flying.
+static double fly_turn(play_turn_fn engine, const Options& opt, LanderState& L, double fr)
+{
+    const turnresult res = (L.*engine)(fr, opt, nullptr);
+    if (res == TURN_DONE) return no_touchdown;
+    if (res == FUEL_OUT) L.fall_without_fuel();
+    return 3600 * fabs(L.V);
+}
+
+// the softest touchdown within the turn from L, between the neighbours of rate r of h, the softest
+// of the rates of the table at best mph. As best_rate() of solve.cpp: the suicide burn is a cusp or
+// a jump (a landing at the lowest point on one side, flying on on the other), where local_min stops
+// short by its relative tolerance, so the offset from there is searched once more.
+static double softest_touchdown(const PolicyHeader& h, play_turn_fn engine, const Options& opt, const LanderState& L,
+    uint32_t r, double best, double& fr)
+{
+    auto touchdown = [&](double x) { LanderState S = L; return fly_turn(engine, opt, S, x); };
+    auto consider = [&](double x)
+    {
+        const double mph = touchdown(x);
+        if (mph < best) { best = mph; fr = x; }
+    };
+    fr = h.rate[r];
+    const uint32_t up = r == 0 ? 2 : r + 1;    // from 0 the next rate up is 8 itself
+    const double a = r < 2 ? 8 : h.rate[r - 1], c = up < h.rates ? h.rate[up] : 200;
+    double x;
+    brent::local_min(a, c, 1e-9, touchdown, x);
+    consider(x);
+    const double x0 = fr, d = 4 * (1.5e-8 * x0 + 1e-9);
+    const double lo = x0 - d < 8 ? 8 - x0 : -d, hi = x0 + d > 200 ? 200 - x0 : d;
+    if (x0 >= 8 && lo < hi)
+    {
+        brent::local_min(lo, hi, 1e-12, [&](double y) { return touchdown(x0 + y); }, x);
+        consider(x0 + x);
+    }
+    return best;
+}
+
+double best_turn(const PolicyHeader& h, const float* values, const Options& opt, const LanderState& L, double& fr)
+{
+    const play_turn_fn engine = turn_engine(opt.CalcMethod);
+    double best = HUGE_VAL, softest = no_touchdown;
+    uint32_t soft = 0;
+    fr = 0;
+    for (uint32_t r = 0; r < h.rates; ++r)
+    {
+        LanderState S = L;
+        const double mph = fly_turn(engine, opt, S, h.rate[r]);
+        if (mph < softest) { softest = mph; soft = r; }
+        const double cost = mph < no_touchdown ? mph : h.grid.interpolate(values, S.A, S.V, S.M);
+        if (cost < best - 1e-9) { best = cost; fr = h.rate[r]; }   // ties go to the lower rate
+    }
+    double x;
+    if (softest < no_touchdown && softest_touchdown(h, engine, opt, L, soft, softest, x) < best) { best = softest; fr = x; }
+    return best;
+}
+
+Policy build_policy(const Options& opt, const PolicyOptions& po, ThreadPool& pool)
+{
+    const LanderState L0;
+    Policy policy;
+    PolicyHeader& h = policy.header;
+    h = PolicyHeader{};
+    memcpy(h.magic, policy_magic, sizeof(h.magic));
+    h.version = policy_version;
+    h.header_size = sizeof(PolicyHeader);
+    h.method = opt.CalcMethod;
+    h.maxdropheightft = opt.maxdropheightft;
+    h.G = L0.G; h.EmptyMass = L0.EmptyMass; h.SpecThrust = L0.SpecThrust;
+
+    PolicyGrid& g = h.grid;
+    const uint32_t n[3] = { po.altitudes, po.speeds, po.masses };
+    for (int d = 0; d < 3; ++d)
+    {
+        g.n[d] = n[d] < 2 ? 2 : n[d];
+        g.blocks[d] = (g.n[d] + policy_block - 1) / policy_block;
+    }
+    g.altitude_max = po.altitude_max;
+    g.speed_lo = po.speed_lo; g.speed_hi = po.speed_hi; g.speed_scale = po.speed_scale;
+    g.mass_lo = L0.EmptyMass; g.mass_hi = L0.M;
+    // 0, then evenly from 8 to 200.
+    h.rates = std::min(std::max(po.rates, 2u), policy_max_rates);
+    for (uint32_t r = 1; r < h.rates; ++r) h.rate[r] = r + 1 == h.rates ? 200 : 8 + 192.0 * (r - 1) / (h.rates - 2);
+    const size_t cells = g.cells();
+    h.values = (sizeof(PolicyHeader) + 63) / 64 * 64;
+    h.actions = h.values + cells * sizeof(float);
+
+    // layer 0: nothing left to do but fall.
+    std::vector<float>& values = policy.values;
+    std::vector<float> previous(cells, 0.0f);
+    values.assign(cells, 0.0f);
+    policy.actions.assign(cells, 0);
+    for (uint32_t i = 0; i < g.n[0]; ++i)
+        for (uint32_t j = 0; j < g.n[1]; ++j)
+            for (uint32_t k = 0; k < g.n[2]; ++k)
+                values[g.cell(i, j, k)] = (float)free_fall_mph(g.altitude(i), g.speed(j), L0.G);
+
+    // The turns do not change from layer to layer, only the values they lead to: each cell flies
+    // every rate once, a turn that lands leaves its touchdown speed, one that does not the cell
+    // coordinates it ends at (12 bytes per rate and cell), and the softest touchdown is refined once.
+    // The layers only interpolate.
+    struct TurnEnd { float x[3]; };         // x[0] is NaN for a turn that lands
+    const size_t nblocks = cells / policy_block_cells;
+    std::vector<TurnEnd> ends(cells * h.rates);
+    std::vector<float> touchdown(cells, (float)no_touchdown), touchdown_fr(cells, 0.0f);
+    const play_turn_fn engine = turn_engine(opt.CalcMethod);
+    auto for_cells = [&](auto&& f)
+    {
+        pool.parallel_for(nblocks, 8, [&](size_t b, size_t e)
+        {
+            for (size_t block = b; block < e; ++block)
+            {   // the block's corner, then its cells in the order of the layout.
+                const uint32_t bi = (uint32_t)(block / ((size_t)g.blocks[1] * g.blocks[2])) * policy_block,
+                    bj = (uint32_t)(block / g.blocks[2] % g.blocks[1]) * policy_block,
+                    bk = (uint32_t)(block % g.blocks[2]) * policy_block;
+                for (uint32_t o = 0; o < policy_block_cells; ++o)
+                {
+                    const uint32_t i = bi + o / (policy_block * policy_block), j = bj + o / policy_block % policy_block,
+                        k = bk + o % policy_block;
+                    f(block, block * policy_block_cells + o, i < g.n[0] && j < g.n[1] && k < g.n[2], i, j, k);
+                }
+            }
+        });
+    };
+    for_cells([&](size_t, size_t c, bool inside, uint32_t i, uint32_t j, uint32_t k)
+    {
+        if (!inside) return;    // padding
+        LanderState L;
+        L.A = g.altitude(i); L.V = g.speed(j); L.M = g.mass(k);
+        double softest = no_touchdown;
+        uint32_t soft = 0;
+        for (uint32_t r = 0; r < h.rates; ++r)
+        {
+            LanderState S = L;
+            const double mph = fly_turn(engine, opt, S, h.rate[r]);
+            double x[3] = { NAN, 0, 0 };
+            if (mph == no_touchdown) g.position(S.A, S.V, S.M, x);
+            ends[c * h.rates + r] = TurnEnd{ { (float)x[0], (float)x[1], (float)x[2] } };
+            if (mph < softest) { softest = mph; soft = r; }
+        }
+        if (softest == no_touchdown) return;
+        double fr;
+        touchdown[c] = (float)softest_touchdown(h, engine, opt, L, soft, softest, fr);
+        touchdown_fr[c] = (float)fr;
+    });
+
+    std::vector<float> change(nblocks);
+    for (h.layers = 0; h.layers < po.layers;)
+    {
+        previous.swap(values);
+        std::fill(change.begin(), change.end(), 0.0f);
+        for_cells([&](size_t block, size_t c, bool inside, uint32_t, uint32_t, uint32_t)
+        {
+            if (!inside) { values[c] = 0; return; }
+            double best = touchdown[c], fr = touchdown_fr[c];
+            for (uint32_t r = 0; r < h.rates; ++r)
+            {
+                const TurnEnd& end = ends[c * h.rates + r];
+                if (std::isnan(end.x[0])) continue;
+                const double x[3] = { end.x[0], end.x[1], end.x[2] };
+                const double cost = g.interpolate(previous.data(), x);
+                if (cost < best - 1e-9) { best = cost; fr = h.rate[r]; }
+            }
+            uint8_t action = 0;     // the rate of the table nearest to the best
+            for (uint32_t r = 1; r < h.rates; ++r)
+                if (fabs(h.rate[r] - fr) < fabs(h.rate[action] - fr)) action = (uint8_t)r;
+            values[c] = (float)best;
+            policy.actions[c] = action;
+            change[block] = std::max(change[block], fabsf(values[c] - previous[c]));
+        });
+        ++h.layers;
+        if (*std::max_element(change.begin(), change.end()) <= po.tolerance) break;
+    }
+    return policy;
+}
+
+bool write_policy(const char* path, const Policy& policy)
+{
+    FILE* out = fopen(path, "wb");
+    if (!out) return false;
+    const PolicyHeader& h = policy.header;
+    static const char zeros[64] = {};
+    bool ok = fwrite(&h, sizeof(h), 1, out) == 1
+        && fwrite(zeros, 1, (size_t)h.values - sizeof(h), out) == (size_t)h.values - sizeof(h)
+        && fwrite(policy.values.data(), sizeof(float), policy.values.size(), out) == policy.values.size()
+        && fwrite(policy.actions.data(), 1, policy.actions.size(), out) == policy.actions.size();
+    return fclose(out) == 0 && ok;
+}
+
+bool PolicyTable::open(const char* path)
+{
+    close();
+#ifdef _WIN32
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (file == INVALID_HANDLE_VALUE) { file = nullptr; message = "cannot open"; return false; }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) { message = "cannot get the size"; close(); return false; }
+    bytes = (size_t)size.QuadPart;
+    if (bytes < sizeof(PolicyHeader)) { message = "too short for a header"; close(); return false; }
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) { message = "cannot map"; close(); return false; }
+    data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    const int fd = ::open(path, O_RDONLY);
+    if (fd < 0) { message = "cannot open"; return false; }
+    struct stat st;
+    if (fstat(fd, &st) != 0) { message = "cannot get the size"; ::close(fd); return false; }
+    bytes = (size_t)st.st_size;
+    if (bytes < sizeof(PolicyHeader)) { message = "too short for a header"; ::close(fd); return false; }
+    void* p = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    data = p == MAP_FAILED ? nullptr : p;
+    if (data) madvise(p, bytes, MADV_WILLNEED);
+#endif
+    if (!data) { message = "cannot map"; close(); return false; }
+    const PolicyHeader& h = header();
+    if (memcmp(h.magic, policy_magic, sizeof(h.magic))) { message = "not a policy file"; close(); return false; }
+    if (h.version != policy_version || h.header_size != sizeof(PolicyHeader))
+    { message = "unknown policy version"; close(); return false; }
+    const PolicyGrid& g = h.grid;
+    bool ok = h.rates >= 1 && h.rates <= policy_max_rates && h.values % alignof(float) == 0 && h.values >= sizeof(PolicyHeader);
+    for (int d = 0; d < 3; ++d) ok = ok && g.n[d] >= 2 && g.blocks[d] == (g.n[d] + policy_block - 1) / policy_block;
+    ok = ok && h.actions == h.values + g.cells() * sizeof(float) && h.actions + g.cells() <= bytes;
+    if (!ok) { message = "damaged policy file"; close(); return false; }
+    message = "";
+    return true;
+}
+
+double PolicyTable::rate(const LanderState& L, const Options& opt) const
+{
+    if (!can_touch_down(L, opt)) return rate(L.A, L.V, L.M);
+    double fr;
+    best_turn(header(), values(), opt, L, fr);
+    return fr;
+}
+
+void PolicyTable::close()
+{
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mapping) CloseHandle(mapping);
+    if (file) CloseHandle(file);
+    mapping = file = nullptr;
+#else
+    if (data) munmap(const_cast<void*>(data), bytes);
+#endif
+    data = nullptr;
+    bytes = 0;
+}
+
+int policy_main(const char* path, const Options& opt, unsigned nthreads, const PolicyOptions& po)
+{
+    ThreadPool pool(nthreads);
+    const auto start = std::chrono::steady_clock::now();
+    const Policy policy = build_policy(opt, po, pool);
+    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!write_policy(path, policy)) { fprintf(stderr, "Cannot write policy file %s\n", path); return 1; }
+    const PolicyHeader& h = policy.header;
+    const PolicyGrid& g = h.grid;
+    const LanderState L;
+    fprintf(stderr, "policy %s: %u x %u x %u cells, %u rates, %u layers in %.1f s with %u threads\n",
+        calcmethod_name(opt.CalcMethod), g.n[0], g.n[1], g.n[2], h.rates, h.layers, s, pool.size());
+    fprintf(stderr, "from the start: %.2f mph (free fall %.2f mph), first rate %g\n",
+        g.interpolate(policy.values.data(), L.A, L.V, L.M), free_fall_mph(L.A, L.V, L.G),
+        g.rate(policy.actions.data(), h.rate, L.A, L.V, L.M));
+    return 0;
+}
+
+}
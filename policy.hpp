@@ -0,0 +1,199 @@
+// Optimal policy (--policy <file>): the best fuel rate for every lander state (altitude, speed, mass)
+// of a grid, by backward dynamic programming over turns. A time layer is the best impact velocity
+// with that many turns left: the first one is the free fall (no more thrust), each next one tries
+// every rate of the table from every cell for one 10 second turn, with play_turn() of the calc
+// method, and takes the value of the cell the turn ends in from the layer before (trilinear
+// interpolation), or the impact velocity if it lands. The layers go on until the values stop
+// changing; the cells of a layer are swept in parallel.
+// A turn that can touch down (a free fall would reach the surface within it) does not stop at the
+// rates of the table: the suicide burn lies between them, and its rate is refined with brent::local_min
+// on the touchdown speed (best_turn()). The autopilot does the same in the turns it can land in.
+// The grid is stored in blocks of 4 x 4 x 4 cells, so the 8 corners of an interpolation are
+// usually in one block (256 bytes of values). Altitude cells are spaced by the square root,
+// closer near the surface; speed cells evenly in asinh(V / speed_scale), a few mph apart around 0
+// and wider with the speed; mass evenly.
+// The file is the header, the values (float, mph) and the rate of each cell (an index into the
+// rates of the header), to be mapped into memory by PolicyTable and looked up in place.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include <type_traits>
+#include <vector>
+#include "lander.hpp"
+
+namespace lander {
+
+class ThreadPool;
+
+const uint32_t policy_block = 4;    // cells along each edge of a block
+const uint32_t policy_block_cells = policy_block * policy_block * policy_block;
+const uint32_t policy_max_rates = 32;
+
+// The cells: altitude i is altitude_max (i / (n[0] - 1))^2, speed j evenly in asinh(V / speed_scale)
+// from lo to hi, mass evenly from lo to hi.
+struct PolicyGrid {
+    uint32_t n[3];              // cells along altitude, speed, mass
+    uint32_t blocks[3];         // blocks along each, n rounded up
+    double altitude_max;        // mi
+    double speed_lo, speed_hi;  // mi/s, downward
+    double speed_scale;         // mi/s, the speed cells are about speed_scale wide times their step around 0
+    double mass_lo, mass_hi;    // lbs
+
+    size_t cells() const { return (size_t)blocks[0] * blocks[1] * blocks[2] * policy_block_cells; }
+    // index of cell i, j, k: its block, then the cell within the block.
+    size_t cell(uint32_t i, uint32_t j, uint32_t k) const
+    {
+        return (((size_t)(i / policy_block) * blocks[1] + j / policy_block) * blocks[2] + k / policy_block) * policy_block_cells
+            + ((i % policy_block) * policy_block + j % policy_block) * policy_block + k % policy_block;
+    }
+    double altitude(uint32_t i) const { const double u = (double)i / (n[0] - 1); return altitude_max * u * u; }
+    double speed(uint32_t j) const
+    {
+        const double lo = asinh(speed_lo / speed_scale), hi = asinh(speed_hi / speed_scale);
+        return j + 1 == n[1] ? speed_hi : speed_scale * sinh(lo + (hi - lo) * j / (n[1] - 1));
+    }
+    double mass(uint32_t k) const { return mass_lo + (mass_hi - mass_lo) * k / (n[2] - 1); }
+
+    // fractional cell coordinates of a state, kept to the grid.
+    void position(double A, double V, double M, double x[3]) const
+    {
+        x[0] = A > 0 ? sqrt(A / altitude_max) * (n[0] - 1) : 0;
+        const double lo = asinh(speed_lo / speed_scale);
+        x[1] = (asinh(V / speed_scale) - lo) / (asinh(speed_hi / speed_scale) - lo) * (n[1] - 1);
+        x[2] = (M - mass_lo) / (mass_hi - mass_lo) * (n[2] - 1);
+        for (int d = 0; d < 3; ++d)
+            x[d] = x[d] > 0 ? (x[d] < n[d] - 1 ? x[d] : n[d] - 1) : 0;
+    }
+    // the 8 cells around a state, and their weights in a trilinear interpolation.
+    void corners(double A, double V, double M, size_t cells[8], double weights[8]) const
+    {
+        double x[3];
+        position(A, V, M, x);
+        corners(x, cells, weights);
+    }
+    // the same from the fractional cell coordinates of position().
+    void corners(const double x[3], size_t cells[8], double weights[8]) const
+    {
+        double w[3];
+        uint32_t c[3];
+        for (int d = 0; d < 3; ++d)
+        {
+            c[d] = (uint32_t)x[d];
+            if (c[d] == n[d] - 1) --c[d];
+            w[d] = x[d] - c[d];
+        }
+        for (int e = 0; e < 8; ++e)
+        {
+            cells[e] = cell(c[0] + (e >> 2), c[1] + (e >> 1 & 1), c[2] + (e & 1));
+            weights[e] = (e & 4 ? w[0] : 1 - w[0]) * (e & 2 ? w[1] : 1 - w[1]) * (e & 1 ? w[2] : 1 - w[2]);
+        }
+    }
+    double interpolate(const float* values, double A, double V, double M) const
+    {
+        double x[3];
+        position(A, V, M, x);
+        return interpolate(values, x);
+    }
+    double interpolate(const float* values, const double x[3]) const
+    {
+        size_t c[8];
+        double w[8], v = 0;
+        corners(x, c, w);
+        for (int e = 0; e < 8; ++e) v += w[e] * values[c[e]];
+        return v;
+    }
+    // the best rates of the cells around a state, interpolated the same way and kept to 0 or 8 to 200.
+    // The nearest cell alone is too coarse near the surface, where a cell spans seconds of burn.
+    double rate(const uint8_t* actions, const double* rates, double A, double V, double M) const
+    {
+        size_t c[8];
+        double w[8], fr = 0;
+        corners(A, V, M, c, w);
+        for (int e = 0; e < 8; ++e) fr += w[e] * rates[actions[c[e]]];
+        return fr < 4 ? 0 : fr < 8 ? 8 : fr;
+    }
+};
+
+struct PolicyHeader {
+    char magic[8];              // "LANDPLCY"
+    uint32_t version;
+    uint32_t header_size;
+    int32_t method;             // calcmethod
+    uint32_t layers;            // time layers computed
+    double maxdropheightft;
+    double G, EmptyMass, SpecThrust;    // lander constants the table holds for
+    PolicyGrid grid;
+    uint32_t rates, reserved;
+    double rate[policy_max_rates];      // the fuel rates tried, lbs/s
+    uint64_t values;            // offset of the values in the file, a float per cell
+    uint64_t actions;           // offset of the best rates, a uint8_t index into rate per cell
+};
+static_assert(std::is_trivially_copyable<PolicyHeader>::value, "the header is written as bytes");
+static_assert(sizeof(PolicyHeader) % 8 == 0, "keep the header aligned");
+
+const uint32_t policy_version = 2;
+
+struct PolicyOptions {
+    uint32_t altitudes{ 96 }, speeds{ 96 }, masses{ 24 };   // cells
+    uint32_t rates{ 26 };       // 0 and evenly from 8 to 200
+    uint32_t layers{ 300 };     // at most
+    double tolerance{ 1e-2 };   // mph: stop when no value changes more
+    double altitude_max{ 130 }, speed_lo{ -0.3 }, speed_hi{ 1.3 }, speed_scale{ 0.01 };
+};
+
+// The best rate for one turn from L, and its cost: the touchdown speed (mph) if the turn lands,
+// else the value of the state it ends in (values, a layer of the grid of h). Each rate of h is
+// tried; in a turn that can touch down the best is refined between its neighbours, down to the
+// suicide burn that lands at the lowest point.
+double best_turn(const PolicyHeader& h, const float* values, const Options& opt, const LanderState& L, double& fr);
+
+// a table built in memory.
+struct Policy {
+    PolicyHeader header;
+    std::vector<float> values;
+    std::vector<uint8_t> actions;
+};
+
+Policy build_policy(const Options& opt, const PolicyOptions& po, ThreadPool& pool);
+bool write_policy(const char* path, const Policy& policy);
+
+// A policy file mapped into memory, read only.
+class PolicyTable {
+public:
+    PolicyTable() = default;
+    PolicyTable(const PolicyTable&) = delete;
+    PolicyTable& operator=(const PolicyTable&) = delete;
+    ~PolicyTable() { close(); }
+
+    // false with a message in error() if the file cannot be mapped or is no policy file.
+    bool open(const char* path);
+    void close();
+    const char* error() const { return message; }
+
+    const PolicyHeader& header() const { return *reinterpret_cast<const PolicyHeader*>(data); }
+    const PolicyGrid& grid() const { return header().grid; }
+    const float* values() const { return reinterpret_cast<const float*>(static_cast<const char*>(data) + header().values); }
+    const uint8_t* actions() const { return static_cast<const uint8_t*>(data) + header().actions; }
+
+    bool is_open() const { return data != nullptr; }
+    // the best rate for a state (PolicyGrid::rate), and the impact velocity (mph) it leads to.
+    double rate(double A, double V, double M) const { return grid().rate(actions(), header().rate, A, V, M); }
+    double value(double A, double V, double M) const { return grid().interpolate(values(), A, V, M); }
+    // the rate for the autopilot: that of the table, or of best_turn() in a turn that can touch down.
+    double rate(const LanderState& L, const Options& opt) const;
+
+private:
+    const void* data{ nullptr };
+    size_t bytes{ 0 };
+    const char* message{ "" };
+#ifdef _WIN32
+    void* file{ nullptr };
+    void* mapping{ nullptr };
+#endif
+};
+
+// --policy front end: builds the table for the calc method of opt and writes it to path.
+int policy_main(const char* path, const Options& opt, unsigned nthreads, const PolicyOptions& po);
+
+}
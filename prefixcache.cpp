@@ -0,0 +1,202 @@
+// Prefix sharing simulation cache, see prefixcache.hpp.
+#include <string.h>
+#include "stats.hpp"
+#include "prefixcache.hpp"
+
+namespace lander {
+
+CacheCounters& CacheCounters::operator+=(const CacheCounters& c)
+{
+    landings += c.landings;
+    turns += c.turns;
+    resumed_turns += c.resumed_turns;
+    evictions += c.evictions;
+    states += c.states;
+    return *this;
+}
+
+// fuel rates are compared bit for bit, as the physics sees them.
+static uint64_t rate_bits(double fr)
+{
+    uint64_t bits;
+    memcpy(&bits, &fr, sizeof(bits));
+    return bits;
+}
+
+// counts the evaluations of the exact lowest point solves, as simulate() does.
+class CountSolves : public TurnObserver {
+public:
+    int evaluations{ 0 };
+    void lowest_point_solved(const LanderState&, int n) override { evaluations += n; }
+};
+
+PrefixCache::PrefixCache(size_t max_bytes)
+{   // a state also costs its edge: a hash node with key, value, link and hash, and a bucket.
+    max_nodes = max_bytes / (sizeof(Node) + sizeof(Edge) + 3 * sizeof(void*) + sizeof(void*));
+    if (max_nodes < 16) max_nodes = 16;
+    if (max_nodes > NONE - 1) max_nodes = NONE - 1;
+}
+
+void PrefixCache::clear()
+{
+    edges.clear();
+    nodes.clear();
+    free_nodes.clear();
+    newest = oldest = NONE;
+    count.states = 0;
+}
+
+uint32_t PrefixCache::find(uint32_t parent, uint64_t fr) const
+{
+    const auto e = edges.find(Edge{ parent, fr });
+    return e == edges.end() ? NONE : e->second;
+}
+
+void PrefixCache::unlink_lru(uint32_t n)
+{
+    Node& node = nodes[n];
+    if (node.newer != NONE) nodes[node.newer].older = node.older; else newest = node.older;
+    if (node.older != NONE) nodes[node.older].newer = node.newer; else oldest = node.newer;
+}
+
+void PrefixCache::touch(uint32_t n)
+{
+    if (newest == n) return;
+    unlink_lru(n);
+    Node& node = nodes[n];
+    node.older = newest;
+    node.newer = NONE;
+    if (newest != NONE) nodes[newest].newer = n;
+    newest = n;
+    if (oldest == NONE) oldest = n;
+}
+
+// Remove the least recently used leaf other than keep (the end of the current path).
+// Parents are always touched after their children, so the oldest nodes are leaves, apart from
+// the path of the landing in progress, which is touched when the landing is done.
+bool PrefixCache::evict(uint32_t keep)
+{
+    uint32_t n = oldest;
+    while (n != NONE && (n == keep || nodes[n].children)) n = nodes[n].newer;
+    if (n == NONE) return false;
+    edges.erase(Edge{ nodes[n].parent, nodes[n].fr });
+    if (nodes[n].parent != NONE) --nodes[nodes[n].parent].children;
+    unlink_lru(n);
+    free_nodes.push_back(n);
+    ++count.evictions;
+    --count.states;
+    return true;
+}
+
+uint32_t PrefixCache::insert(uint32_t parent, uint64_t fr)
+{
+    if (count.states >= max_nodes && !evict(parent)) return NONE;
+    uint32_t n;
+    if (!free_nodes.empty()) { n = free_nodes.back(); free_nodes.pop_back(); }
+    else { n = (uint32_t)nodes.size(); nodes.emplace_back(); }
+    Node& node = nodes[n];
+    node.fr = fr;
+    node.parent = parent;
+    node.children = 0;
+    if (parent != NONE) ++nodes[parent].children;
+    edges.emplace(Edge{ parent, fr }, n);
+    node.newer = node.older = NONE;
+    if (oldest == NONE) oldest = newest = n;
+    else { node.older = newest; nodes[newest].newer = n; newest = n; }
+    ++count.states;
+    return n;
+}
+
+LandingResult PrefixCache::simulate(const Schedule& schedule, const Options& opt)
+{
+    if (opt.CalcMethod != options.CalcMethod || opt.maxdropheightft != options.maxdropheightft)
+    {
+        clear();
+        options = opt;
+    }
+    switch (opt.CalcMethod)
+    {
+    case EXACT: return land<EXACT>(schedule, opt);
+    case BUGFIXED: return land<BUGFIXED>(schedule, opt);
+    default: return land<ORIGINAL>(schedule, opt);
+    }
+}
+
+template <calcmethod method>
+LandingResult PrefixCache::land(const Schedule& schedule, const Options& opt)
+{
+    ++count.landings;
+    LanderState L;
+    LandingResult result;
+    CountSolves solves;
+    result.method = method;
+#ifdef LANDER_STATS
+    stats = Stats{};
+#endif
+    path.clear();
+    uint32_t at = NONE;         // node of the state L, NONE for the start
+    bool cached = true;         // L is in the cache
+    size_t next = 0;
+    double fr = 0;
+    for (;;)
+    {   // the turns as simulate() plays them.
+        while (next < schedule.size())
+            if (valid_fuel_rate(schedule[next++])) { fr = schedule[next - 1]; break; }
+        ++result.turns;
+        ++count.turns;
+        const uint64_t bits = rate_bits(fr);
+        if (cached)
+        {
+            const uint32_t n = find(at, bits);
+            if (n != NONE)
+            {   // resume after this turn.
+                const Node& node = nodes[n];
+                L = node.state;
+                solves.evaluations = node.solver_evaluations;
+#ifdef LANDER_STATS
+                stats = node.stats;
+#endif
+                at = n;
+                path.push_back(n);
+                ++count.resumed_turns;
+                continue;
+            }
+        }
+        const turnresult res = L.play_turn<method>(fr, opt, &solves);
+        if (res == TURN_DONE)
+        {
+            const uint32_t n = cached ? insert(at, bits) : NONE;
+            cached = n != NONE;
+            if (cached)
+            {
+                Node& node = nodes[n];
+                node.state = L;
+                node.solver_evaluations = solves.evaluations;
+#ifdef LANDER_STATS
+                node.stats = stats;
+#endif
+                at = n;
+                path.push_back(n);
+            }
+            continue;
+        }
+        if (res == FUEL_OUT)
+        {
+            result.fuel_out_T = L.T;
+            L.fall_without_fuel();
+        }
+        break;
+    }
+    // most recent last, after all of their children.
+    for (size_t i = path.size(); i-- > 0;) touch(path[i]);
+    result.T = L.T;
+    result.V = L.V;
+    result.fuel = L.fuel();
+    result.solver_evaluations = solves.evaluations;
+#ifdef LANDER_STATS
+    result.stats = stats;
+#endif
+    return result;
+}
+
+}
@@ -0,0 +1,77 @@
+// Cache for schedule sweeps: the lander state after every turn, in a trie keyed by the fuel rates
+// of the turns so far. Schedules sharing their first turns (seven zero-burn turns, then the burn)
+// resume from the longest cached prefix instead of landing again from T = 0.
+// Memory is bounded; the least recently used states are evicted first.
+// Not thread safe: use one cache per thread.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+#include "lander.hpp"
+
+namespace lander {
+
+struct CacheCounters {
+    long landings{ 0 };
+    long turns{ 0 };            // turns of all landings
+    long resumed_turns{ 0 };    // of which taken from the cache
+    long evictions{ 0 };
+    size_t states{ 0 };         // cached now
+    double hit_rate() const { return turns ? (double)resumed_turns / turns : 0; }
+    CacheCounters& operator+=(const CacheCounters& c);
+};
+
+class PrefixCache {
+public:
+    // max_bytes is the budget for the cached states, at least a few are kept.
+    explicit PrefixCache(size_t max_bytes = 64u << 20);
+
+    // the same result as lander::simulate(schedule, opt), bit for bit.
+    // A change of options empties the cache, the states depend on them.
+    LandingResult simulate(const Schedule& schedule, const Options& opt);
+
+    void clear();
+    const CacheCounters& counters() const { return count; }
+    size_t capacity() const { return max_nodes; }
+
+private:
+    static const uint32_t NONE = 0xffffffffu;
+    struct Node {
+        uint64_t fr;                // bits of the fuel rate of the turn
+        LanderState state;          // after the turn
+        int solver_evaluations;     // up to and including the turn
+#ifdef LANDER_STATS
+        Stats stats;
+#endif
+        uint32_t parent, children;
+        uint32_t newer, older;      // lru list
+    };
+    // the edges of the trie, (parent, fuel rate) to child: one hash lookup per turn.
+    struct Edge {
+        uint32_t parent;
+        uint64_t fr;
+        bool operator==(const Edge& e) const { return parent == e.parent && fr == e.fr; }
+    };
+    struct EdgeHash {
+        size_t operator()(const Edge& e) const
+        { return (size_t)(((e.fr ^ (e.fr >> 32)) + ((uint64_t)e.parent << 20) + e.parent) * 0x9e3779b97f4a7c15ull >> 16); }
+    };
+    std::unordered_map<Edge, uint32_t, EdgeHash> edges;
+    std::vector<Node> nodes;        // the root (T = 0) is not stored
+    std::vector<uint32_t> free_nodes;
+    std::vector<uint32_t> path;     // nodes of the landing in progress
+    uint32_t newest{ NONE }, oldest{ NONE };
+    size_t max_nodes;
+    Options options;
+    CacheCounters count;
+
+    template <calcmethod method> LandingResult land(const Schedule& schedule, const Options& opt);
+    uint32_t find(uint32_t parent, uint64_t fr) const;
+    uint32_t insert(uint32_t parent, uint64_t fr);
+    bool evict(uint32_t keep);
+    void unlink_lru(uint32_t n);
+    void touch(uint32_t n);
+};
+
+}
@@ -0,0 +1,348 @@
+// Simulation service, see server.hpp.
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+ #include <winsock2.h>
+ #include <afunix.h>
+ #pragma comment(lib, "Ws2_32.lib")
+#else
+ #include <fcntl.h>
+ #include <poll.h>
+ #include <sys/socket.h>
+ #include <sys/un.h>
+ #include <unistd.h>
+#endif
+#include "lander.hpp"
+#include "batch.hpp"
+#include "input.hpp"
+#include "threadpool.hpp"
+#include "trajectory.hpp"
+#include "session.hpp"
+#include "server.hpp"
+
+#ifdef _WIN32
+typedef SOCKET socket_t;
+static const socket_t no_socket = INVALID_SOCKET;
+static void close_socket(socket_t s) { closesocket(s); }
+static bool set_nonblocking(socket_t s) { u_long on = 1; return ioctlsocket(s, FIONBIO, &on) == 0; }
+static int poll_sockets(pollfd* fds, size_t n) { return WSAPoll(fds, (ULONG)n, -1); }
+static bool would_block() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+static bool start_sockets() { WSADATA data; return WSAStartup(MAKEWORD(2, 2), &data) == 0; }
+#else
+typedef int socket_t;
+static const socket_t no_socket = -1;
+static void close_socket(socket_t s) { close(s); }
+static bool set_nonblocking(socket_t s) { return fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK) == 0; }
+static int poll_sockets(pollfd* fds, size_t n) { return poll(fds, (nfds_t)n, -1); }
+static bool would_block() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+static bool start_sockets() { return true; }
+#endif
+#ifndef MSG_NOSIGNAL
+ #define MSG_NOSIGNAL 0     // a closed peer gives an error, not SIGPIPE
+#endif
+
+namespace lander {
+
+static bool socket_address(const char* path, sockaddr_un& addr)
+{
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) { fprintf(stderr, "Socket path too long: %s\n", path); return false; }
+    strcpy(addr.sun_path, path);
+    return true;
+}
+
+static void append_result(const LandingResult& r, std::string& reply)
+{
+    char text[200];
+    const int n = snprintf(text, sizeof(text), "%d,%.17g,%.17g,%.17g,%s,%s,%.17g", r.turns, r.T, r.impact_mph(),
+        r.fuel, landingclass_name(classify(r.impact_mph())), calcmethod_name(r.method), r.fuel_out_T);
+    reply.append(text, n);
+}
+
+// the rows of a game turn, see server.hpp.
+static void append_rows(const GameSession& game, std::string& reply)
+{
+    static const char* names[] = { "turn", "substep", "lowest", "fuel_out", "landed" };
+    for (const TrajectoryRecord& r : game.rows())
+    {
+        char text[200];
+        int n = 0;
+        if (r.kind == TRAJ_TURN)
+            n = snprintf(text, sizeof(text), "; %s %.17g,%.17g,%.17g,%.17g", names[r.kind], r.T, r.A, 3600 * r.V, r.fuel);
+        else if (r.kind == TRAJ_SUBSTEP || r.kind == TRAJ_LOWEST_POINT)
+            n = snprintf(text, sizeof(text), "; %s %.17g,%.17g,%.17g,%.17g,%.17g", names[r.kind], r.T, r.A, 3600 * r.V,
+                r.fuel, r.FR);
+        else if (r.kind == TRAJ_FUEL_OUT)
+            n = snprintf(text, sizeof(text), "; %s %.17g", names[r.kind], r.T);
+        else
+        {
+            reply.append("; landed ");
+            append_result(game.result(), reply);
+            continue;
+        }
+        reply.append(text, n);
+    }
+}
+
+// the states R accepts: a lander that lands within some thousands of turns, whatever the rates.
+// Fuel lasts 2000 s at most, and at 10 mi/s upward it is back down after 2000 turns.
+static const double max_altitude = 1000;   // mi
+static const double max_speed = 10;        // mi/s, up or down
+static const double max_turns = 1000000;   // played before, far from the int32_t of Snapshot
+
+bool answer_query(const char* p, const char* end, const Options& opt, std::string& reply, GameSession* game)
+{
+    static thread_local Schedule values;
+    while (p < end && isspace((unsigned char)*p)) ++p;
+    const char request = p < end ? (char)toupper((unsigned char)*p++) : 0;
+    Options o = opt;
+    while (p < end && isspace((unsigned char)*p)) ++p;
+    if (end - p > 5 && !strncmp(p, "calc=", 5))
+    {   // the first letters do, as calc= of the game: original, bugfixed (fixed, new) or exact.
+        switch (tolower((unsigned char)p[5]))
+        {
+        case 'o': o.CalcMethod = ORIGINAL; break;
+        case 'b': case 'f': case 'n': o.CalcMethod = BUGFIXED; break;
+        case 'e': o.CalcMethod = EXACT; break;
+        default: reply = "error unknown calc method"; return false;
+        }
+        while (p < end && !isspace((unsigned char)*p)) ++p;
+    }
+    if (!parse_schedule(p, end, values)) { reply = "error not a fuel rate"; return false; }
+    for (double x : values)
+        if (!std::isfinite(x)) { reply = "error not finite"; return false; }    // nan would never land
+    if (request == 'N' || request == 'F')
+    {
+        if (!game) { reply = "error no game on this connection"; return false; }
+        if (request == 'N') game->start(o);
+        else if (!game->started() || game->landed()) { reply = "error no game in flight, N starts one"; return false; }
+        else if (values.size() != 1) { reply = "error F needs one fuel rate"; return false; }
+        else if (!game->resume(values[0])) { reply = "error NOT POSSIBLE"; return false; }
+        reply = "ok";
+        append_rows(*game, reply);
+        return true;
+    }
+    LandingResult r;
+    switch (request)
+    {
+    case 'L':
+        r = simulator(o.CalcMethod)(values, o);
+        break;
+    case 'R':
+    {   // the rates follow the state in the same vector, the snapshot starts at them.
+        if (values.size() < 5 || values[4] < 0) { reply = "error R needs A V M T turns"; return false; }
+        const LanderState L0;
+        if (values[0] < 0 || values[0] > max_altitude || fabs(values[1]) > max_speed || values[2] < L0.EmptyMass
+            || values[2] > L0.M || values[4] > max_turns)
+        { reply = "error R state out of range"; return false; }
+        const Snapshot from{ values[0], values[1], values[2], values[3], 0, 5, (int32_t)values[4], 0 };
+        r = resimulate(from, values, o);
+        break;
+    }
+    default:
+        reply = "error unknown request";
+        return false;
+    }
+    reply = "ok ";
+    append_result(r, reply);
+    return true;
+}
+
+struct Connection {
+    explicit Connection(socket_t s) : s(s) {}
+    socket_t s;
+    std::string in, out;        // received up to an incomplete line, replies not sent yet
+    bool closing{ false };      // Q received: close when the replies are out
+    bool broken{ false };       // closed by the client or failed: drop
+    GameSession game;           // N and F
+};
+
+struct Query {
+    size_t connection;
+    std::string request, reply;
+    bool game;                  // N or F: answered in order on the loop's thread
+};
+
+// reads what the socket has, and takes the complete lines as queries. A client that shut down
+// its side still gets the replies to them.
+static void receive(Connection& c, size_t index, std::vector<Query>& queries)
+{
+    char chunk[16384];
+    bool shut_down = false;
+    for (;;)
+    {
+        const int n = (int)recv(c.s, chunk, sizeof(chunk), 0);
+        if (n > 0) { c.in.append(chunk, n); continue; }
+        if (n < 0 && would_block()) break;
+        if (n < 0) { c.broken = true; return; }
+        shut_down = true;
+        break;
+    }
+    size_t begin = 0;
+    for (size_t eol; !c.closing && (eol = c.in.find('\n', begin)) != std::string::npos; begin = eol + 1)
+    {
+        size_t e = eol;
+        while (e > begin && isspace((unsigned char)c.in[e - 1])) --e;
+        size_t b = begin;
+        while (b < e && isspace((unsigned char)c.in[b])) ++b;
+        if (b == e) continue;
+        if (e - b == 1 && toupper((unsigned char)c.in[b]) == 'Q') { c.closing = true; break; }
+        const char request = (char)toupper((unsigned char)c.in[b]);
+        queries.push_back(Query{ index, c.in.substr(b, e - b), std::string(), request == 'N' || request == 'F' });
+    }
+    c.in.erase(0, begin);
+    if (shut_down) c.closing = true;
+}
+
+static void send_replies(Connection& c)
+{
+    size_t sent = 0;
+    while (sent < c.out.size())
+    {
+        const int n = (int)send(c.s, c.out.data() + sent, (int)(c.out.size() - sent), MSG_NOSIGNAL);
+        if (n > 0) { sent += n; continue; }
+        if (n < 0 && would_block()) break;
+        c.broken = true;
+        break;
+    }
+    c.out.erase(0, sent);
+}
+
+int serve_main(const char* path, const Options& opt, unsigned nthreads)
+{
+    sockaddr_un addr;
+    if (!socket_address(path, addr) || !start_sockets()) return 1;
+    const socket_t listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener == no_socket) { fprintf(stderr, "Cannot create a socket\n"); return 1; }
+    remove(path);       // left by an earlier server
+    if (bind(listener, (const sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 64) != 0 || !set_nonblocking(listener))
+    {
+        fprintf(stderr, "Cannot listen on %s\n", path);
+        close_socket(listener);
+        return 1;
+    }
+    ThreadPool pool(nthreads);
+    fprintf(stderr, "serving on %s, %s, %u workers\n", path, calcmethod_name(opt.CalcMethod), pool.size());
+
+    std::vector<Connection> connections;
+    std::vector<pollfd> fds;
+    std::vector<Query> queries;
+    for (;;)
+    {   // the listener first, then a pollfd per connection in the same order.
+        fds.clear();
+        fds.push_back(pollfd{ listener, POLLIN, 0 });
+        for (const Connection& c : connections)
+            fds.push_back(pollfd{ c.s, (short)(c.out.empty() ? POLLIN : POLLIN | POLLOUT), 0 });
+        if (poll_sockets(fds.data(), fds.size()) < 0)
+        {
+            if (would_block()) continue;
+            fprintf(stderr, "poll failed on %s\n", path);
+            break;
+        }
+        for (size_t i = 0; i < connections.size(); ++i)
+            if (fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) receive(connections[i], i, queries);
+
+        // game turns take a microsecond and share their session: all of them right here, in order.
+        // A single landing is answered here as well, a burst from many clients is spread over the pool.
+        size_t landings = 0;
+        for (Query& q : queries)
+            if (q.game)
+                answer_query(q.request.data(), q.request.data() + q.request.size(), opt, q.reply,
+                    &connections[q.connection].game);
+            else ++landings;
+        if (landings < 8)
+        {
+            for (Query& q : queries)
+                if (!q.game) answer_query(q.request.data(), q.request.data() + q.request.size(), opt, q.reply);
+        }
+        else
+            pool.parallel_for(queries.size(), 4, [&](size_t b, size_t e)
+            {
+                for (size_t k = b; k < e; ++k)
+                    if (!queries[k].game)
+                        answer_query(queries[k].request.data(), queries[k].request.data() + queries[k].request.size(),
+                            opt, queries[k].reply);
+            });
+        for (Query& q : queries) connections[q.connection].out.append(q.reply).push_back('\n');
+        queries.clear();
+
+        for (Connection& c : connections)
+            if (!c.out.empty() && !c.broken) send_replies(c);
+        size_t kept = 0;
+        for (size_t i = 0; i < connections.size(); ++i)
+        {
+            Connection& c = connections[i];
+            if (c.broken || (c.closing && c.out.empty())) { close_socket(c.s); continue; }
+            if (kept != i) connections[kept] = std::move(c);    // a move into itself would empty it
+            ++kept;
+        }
+        connections.erase(connections.begin() + kept, connections.end());
+
+        if (fds[0].revents & POLLIN)
+            for (socket_t s; (s = accept(listener, nullptr, nullptr)) != no_socket;)
+            {
+                if (!set_nonblocking(s)) { close_socket(s); continue; }
+                connections.emplace_back(s);
+            }
+    }
+    for (Connection& c : connections) close_socket(c.s);
+    close_socket(listener);
+    remove(path);
+    return 1;
+}
+
+int query_main(const char* path)
+{
+    sockaddr_un addr;
+    if (!socket_address(path, addr) || !start_sockets()) return 1;
+    const socket_t s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s == no_socket || connect(s, (const sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        fprintf(stderr, "Cannot connect to %s\n", path);
+        if (s != no_socket) close_socket(s);
+        return 1;
+    }
+    LineReader input(stdin);
+    std::string request, received;
+    long queries = 0;
+    double total_us = 0, min_us = 0;
+    while (const char* line = input.next())
+    {
+        if (!*line) continue;
+        request.assign(line).push_back('\n');
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t sent = 0; sent < request.size();)
+        {
+            const int n = (int)send(s, request.data() + sent, (int)(request.size() - sent), MSG_NOSIGNAL);
+            if (n <= 0) { fprintf(stderr, "Connection to %s lost\n", path); close_socket(s); return 1; }
+            sent += n;
+        }
+        if (request[0] == 'q' || request[0] == 'Q') break;
+        size_t eol;
+        while ((eol = received.find('\n')) == std::string::npos)
+        {
+            char chunk[4096];
+            const int n = (int)recv(s, chunk, sizeof(chunk), 0);
+            if (n <= 0) { fprintf(stderr, "Connection to %s lost\n", path); close_socket(s); return 1; }
+            received.append(chunk, n);
+        }
+        const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        total_us += us;
+        if (queries++ == 0 || us < min_us) min_us = us;
+        fwrite(received.data(), 1, eol + 1, stdout);
+        received.erase(0, eol + 1);
+    }
+    close_socket(s);
+    if (queries)
+        fprintf(stderr, "query: %ld round trips, %.1f us mean, %.1f us min\n", queries, total_us / queries, min_us);
+    return 0;
+}
+
+}
@@ -0,0 +1,39 @@
+// Simulation service (--serve <socket>): a long running process answering what-if queries on a Unix
+// domain socket, so a query costs a landing and a round trip instead of starting the game.
+// One event loop polls all connections; the queries that arrive together are landed on the thread pool.
+// A connection can also play a game turn by turn, its session resumed on the loop's thread.
+// Line protocol, a request and its reply per line, fuel rates as in a batch file:
+//    L [calc=<method>] fr fr ...           land the schedule from the start
+//    R [calc=<method>] A V M T turns fr ...  resume: the lander at altitude A (mi), speed V (mi/s),
+//                                          mass M (lbs) and time T (s) after turns turns flies the rates;
+//                                          A up to 1000, |V| up to 10, M from empty to full, turns up to 1e6
+//    N [calc=<method>]                     start a game on this connection (session.hpp)
+//    F fr                                  fly its next turn
+//    Q                                     close the connection
+// The reply is "ok turns,time,impact_mph,fuel_left,landing,calc,fuel_out_time" (the columns of --batch)
+// or "error <reason>". Without calc= the server's calc method is used. N and F reply "ok" and the rows up
+// to the next prompt, each after "; ": "turn T,A,mph,fuel", "substep" and "lowest" the same and the
+// fuel rate, "fuel_out T" and "landed" with the columns above. A rate the game refuses gives
+// "error NOT POSSIBLE" and the turn can be tried again. T in s, A in miles.
+// Windows (10 and later) has AF_UNIX sockets as well.
+#pragma once
+#include <stddef.h>
+#include <string>
+#include "lander.hpp"
+
+namespace lander {
+
+class GameSession;
+
+// the reply to one request line, without the line end. Returns false for a request that is no
+// query (the reply then is the error). N and F play game, if given.
+bool answer_query(const char* p, const char* end, const Options& opt, std::string& reply, GameSession* game = nullptr);
+
+// --serve front end: listens on path until the process is stopped. Returns the exit code for main().
+int serve_main(const char* path, const Options& opt, unsigned nthreads);
+
+// --query front end, a client for testing: sends the lines of stdin one at a time and prints the
+// replies, with the round trip times on stderr.
+int query_main(const char* path);
+
+}
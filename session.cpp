@@ -0,0 +1,66 @@
+// Resumable game, see session.hpp.
+#include "lander.hpp"
+#include "trajectory.hpp"
+#include "session.hpp"
+
+namespace lander {
+
+void GameSession::start(const Options& options)
+{
+    L = LanderState{};
+    opt = options;
+    if (opt.CalcMethod == UNDECIDED) opt.CalcMethod = ORIGINAL;
+    engine = turn_engine(opt.CalcMethod);
+    landing = LandingResult{};
+    landing.method = opt.CalcMethod;
+    done = false;
+    turns = 1;
+    events.clear();
+    row(L, TRAJ_TURN, L.V);
+}
+
+bool GameSession::resume(double fr)
+{
+    if (!started() || done || !valid_fuel_rate(fr)) return false;
+    events.clear();
+    const turnresult res = (L.*engine)(fr, opt, this);
+    if (res == TURN_DONE)
+    {
+        ++turns;
+        row(L, TRAJ_TURN, L.V);
+        return true;
+    }
+    if (res == FUEL_OUT)
+    {
+        landing.fuel_out_T = L.T;
+        row(L, TRAJ_FUEL_OUT, L.V);
+        L.fall_without_fuel();
+    }
+    done = true;
+    landing.turns = turns;
+    landing.T = L.T;
+    landing.V = L.V;
+    landing.fuel = L.fuel();
+    row(L, TRAJ_ON_THE_MOON, L.V);
+    return true;
+}
+
+void GameSession::row(const LanderState& S, trajectorykind kind, double V)
+{
+    TrajectoryRecord r;
+    r.T = S.T;
+    r.A = S.A;
+    r.V = V;
+    r.fuel = S.fuel();
+    r.FR = S.FR;
+    r.landing = 0;
+    r.turn = (uint16_t)turns;
+    r.kind = kind;
+    r.reserved = 0;
+    events.push_back(r);
+}
+
+void GameSession::substep(const LanderState& S) { row(S, TRAJ_SUBSTEP, S.V); }
+void GameSession::lowest_point(const LanderState& S) { row(S, TRAJ_LOWEST_POINT, S.EndSpeed); }
+
+}
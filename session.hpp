@@ -0,0 +1,53 @@
+// A game as a resumable state machine: it stops at every FR:= prompt and is resumed with the next
+// fuel rate, handing out the rows of the table the turn produced. The whole state is the lander,
+// the options and the last rows, so one thread can keep thousands of sessions (players, bots,
+// scripted runs) going side by side, e.g. a game per connection of --serve. The game of lunarlander.cpp
+// runs on one as well, printing its rows and answering its prompts.
+// The steps are those of the FOCAL game: 02.10 row, 02.70 prompt, 03.10 to 09.40 the turn, 04.10
+// fuel out, 05.10 on the moon.
+#pragma once
+#include <vector>
+#include "lander.hpp"
+#include "trajectory.hpp"
+
+namespace lander {
+
+class GameSession : private TurnObserver {
+public:
+    GameSession() = default;
+    explicit GameSession(const Options& opt) { start(opt); }
+
+    // a new game (01.50): rows() holds the first turn row and the session waits for its fuel rate.
+    void start(const Options& opt);
+    bool started() const { return turns > 0; }
+    bool landed() const { return done; }
+
+    // fly the turn with fr. Returns false and leaves everything as it was for a rate the game refuses
+    // (NOT POSSIBLE at 02.72), or when there is no game in flight.
+    bool resume(double fr);
+
+    // the rows since the last start() or resume(), in the order of the game's table, as trajectory
+    // records: sub-steps and lowest point of the turn, then the next turn row, or fuel out and the
+    // landing. A turn row holds the fuel rate of the turn before it, its own is not given yet.
+    const std::vector<TrajectoryRecord>& rows() const { return events; }
+    const LanderState& lander() const { return L; }
+    const Options& options() const { return opt; }
+    // the landing, once landed().
+    const LandingResult& result() const { return landing; }
+
+private:
+    LanderState L;
+    Options opt;
+    play_turn_fn engine{ nullptr };
+    std::vector<TrajectoryRecord> events;
+    LandingResult landing;
+    int turns{ 0 };
+    bool done{ false };
+
+    void row(const LanderState& S, trajectorykind kind, double V);
+    void substep(const LanderState& S) override;
+    void lowest_point(const LanderState& S) override;
+    void lowest_point_solved(const LanderState&, int evaluations) override { landing.solver_evaluations += evaluations; }
+};
+
+}
@@ -0,0 +1,158 @@
+// Minimal vector types for the batched physics: the same template code is instantiated for
+// plain double (scalar fallback and loop tails) and for AVX2 / AVX-512 registers.
+// Every operator is a single IEEE operation, so a lane computes exactly what the scalar code does,
+// provided the compiler does not contract a * b + c into an fma in one of them
+// (MSVC does not by default, use -ffp-contract=off with gcc/clang when targeting fma hardware).
+// The instruction set is chosen at compile time (/arch:AVX2, /arch:AVX512, -mavx2, -mavx512f).
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(__AVX512F__) || defined(__AVX2__)
+ #include <immintrin.h>
+#endif
+
+namespace simd {
+
+// scalar "vector" of one lane.
+inline double load(const double* p, double) { return *p; }
+inline void store(double* p, double x) { *p = x; }
+inline double broadcast(double x, double) { return x; }
+inline double select(bool mask, double a, double b) { return mask ? a : b; }
+inline bool greater(double a, double b) { return a > b; }
+inline bool both(bool a, bool b) { return a && b; }
+// u = m * 2^k with m in [sqrt(2)/2, sqrt(2)), for positive normal u.
+inline void split_sqrt2(double u, double& m, double& k)
+{
+    uint64_t bits;
+    memcpy(&bits, &u, sizeof(bits));
+    const uint64_t mant = bits & 0x000fffffffffffffull;
+    const bool high = mant >= 0x6a09e00000000ull;     // mantissa >= sqrt(2), halve it
+    const int64_t e = (int64_t)(bits >> 52) + high - 1023;
+    bits = mant | (high ? 0x3fe0000000000000ull : 0x3ff0000000000000ull);
+    memcpy(&m, &bits, sizeof(m));
+    k = (double)e;
+}
+
+#if defined(__AVX2__)
+struct vd4 {
+    __m256d v;
+    static constexpr size_t width = 4;
+};
+inline vd4 operator+(vd4 a, vd4 b) { return { _mm256_add_pd(a.v, b.v) }; }
+inline vd4 operator-(vd4 a, vd4 b) { return { _mm256_sub_pd(a.v, b.v) }; }
+inline vd4 operator*(vd4 a, vd4 b) { return { _mm256_mul_pd(a.v, b.v) }; }
+inline vd4 operator/(vd4 a, vd4 b) { return { _mm256_div_pd(a.v, b.v) }; }
+inline vd4 operator-(vd4 a) { return { _mm256_xor_pd(a.v, _mm256_set1_pd(-0.0)) }; }  // sign flip, as scalar -x
+inline vd4 operator+(vd4 a, double b) { return { _mm256_add_pd(a.v, _mm256_set1_pd(b)) }; }
+inline vd4 operator-(vd4 a, double b) { return { _mm256_sub_pd(a.v, _mm256_set1_pd(b)) }; }
+inline vd4 operator*(vd4 a, double b) { return { _mm256_mul_pd(a.v, _mm256_set1_pd(b)) }; }
+inline vd4 operator/(vd4 a, double b) { return { _mm256_div_pd(a.v, _mm256_set1_pd(b)) }; }
+inline vd4 operator+(double a, vd4 b) { return { _mm256_add_pd(_mm256_set1_pd(a), b.v) }; }
+inline vd4 operator-(double a, vd4 b) { return { _mm256_sub_pd(_mm256_set1_pd(a), b.v) }; }
+inline vd4 operator*(double a, vd4 b) { return { _mm256_mul_pd(_mm256_set1_pd(a), b.v) }; }
+inline vd4 operator/(double a, vd4 b) { return { _mm256_div_pd(_mm256_set1_pd(a), b.v) }; }
+inline vd4 load(const double* p, vd4) { return { _mm256_loadu_pd(p) }; }
+inline void store(double* p, vd4 x) { _mm256_storeu_pd(p, x.v); }
+inline vd4 broadcast(double x, vd4) { return { _mm256_set1_pd(x) }; }
+inline __m256d greater(vd4 a, vd4 b) { return _mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ); }
+inline vd4 select(__m256d mask, vd4 a, vd4 b) { return { _mm256_blendv_pd(b.v, a.v, mask) }; }
+inline __m256d both(__m256d a, __m256d b) { return _mm256_and_pd(a, b); }
+inline void split_sqrt2(vd4 u, vd4& m, vd4& k)
+{
+    const __m256i bits = _mm256_castpd_si256(u.v);
+    const __m256i mant = _mm256_and_si256(bits, _mm256_set1_epi64x(0x000fffffffffffffll));
+    const __m256i high = _mm256_cmpgt_epi64(mant, _mm256_set1_epi64x(0x6a09e00000000ll - 1));   // -1 where halved
+    const __m256i e = _mm256_sub_epi64(_mm256_srli_epi64(bits, 52), high);      // biased exponent
+    m.v = _mm256_castsi256_pd(_mm256_or_si256(mant,
+        _mm256_blendv_epi8(_mm256_set1_epi64x(0x3ff0000000000000ll), _mm256_set1_epi64x(0x3fe0000000000000ll), high)));
+    // integer to double without avx-512: put it in the mantissa of 2^52 and subtract 2^52 (and the bias).
+    const __m256d two52 = _mm256_set1_pd(4503599627370496.0);
+    k.v = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(e, _mm256_castpd_si256(two52))),
+        _mm256_set1_pd(4503599627370496.0 + 1023));
+}
+#endif
+
+#if defined(__AVX512F__)
+struct vd8 {
+    __m512d v;
+    static constexpr size_t width = 8;
+};
+inline vd8 operator+(vd8 a, vd8 b) { return { _mm512_add_pd(a.v, b.v) }; }
+inline vd8 operator-(vd8 a, vd8 b) { return { _mm512_sub_pd(a.v, b.v) }; }
+inline vd8 operator*(vd8 a, vd8 b) { return { _mm512_mul_pd(a.v, b.v) }; }
+inline vd8 operator/(vd8 a, vd8 b) { return { _mm512_div_pd(a.v, b.v) }; }
+inline vd8 operator-(vd8 a)
+{ return { _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a.v), _mm512_set1_epi64(0x8000000000000000ll))) }; }
+inline vd8 operator+(vd8 a, double b) { return { _mm512_add_pd(a.v, _mm512_set1_pd(b)) }; }
+inline vd8 operator-(vd8 a, double b) { return { _mm512_sub_pd(a.v, _mm512_set1_pd(b)) }; }
+inline vd8 operator*(vd8 a, double b) { return { _mm512_mul_pd(a.v, _mm512_set1_pd(b)) }; }
+inline vd8 operator/(vd8 a, double b) { return { _mm512_div_pd(a.v, _mm512_set1_pd(b)) }; }
+inline vd8 operator+(double a, vd8 b) { return { _mm512_add_pd(_mm512_set1_pd(a), b.v) }; }
+inline vd8 operator-(double a, vd8 b) { return { _mm512_sub_pd(_mm512_set1_pd(a), b.v) }; }
+inline vd8 operator*(double a, vd8 b) { return { _mm512_mul_pd(_mm512_set1_pd(a), b.v) }; }
+inline vd8 operator/(double a, vd8 b) { return { _mm512_div_pd(_mm512_set1_pd(a), b.v) }; }
+inline vd8 load(const double* p, vd8) { return { _mm512_loadu_pd(p) }; }
+inline void store(double* p, vd8 x) { _mm512_storeu_pd(p, x.v); }
+inline vd8 broadcast(double x, vd8) { return { _mm512_set1_pd(x) }; }
+inline __mmask8 greater(vd8 a, vd8 b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_GT_OQ); }
+inline vd8 select(__mmask8 mask, vd8 a, vd8 b) { return { _mm512_mask_blend_pd(mask, b.v, a.v) }; }
+inline __mmask8 both(__mmask8 a, __mmask8 b) { return a & b; }
+inline void split_sqrt2(vd8 u, vd8& m, vd8& k)
+{
+    const __m512i bits = _mm512_castpd_si512(u.v);
+    const __m512i mant = _mm512_and_si512(bits, _mm512_set1_epi64(0x000fffffffffffffll));
+    const __mmask8 high = _mm512_cmpge_epu64_mask(mant, _mm512_set1_epi64(0x6a09e00000000ll));
+    const __m512i biased = _mm512_srli_epi64(bits, 52);
+    const __m512i e = _mm512_mask_add_epi64(biased, high, biased, _mm512_set1_epi64(1));
+    m.v = _mm512_castsi512_pd(_mm512_or_si512(mant,
+        _mm512_mask_blend_epi64(high, _mm512_set1_epi64(0x3ff0000000000000ll), _mm512_set1_epi64(0x3fe0000000000000ll))));
+    const __m512d two52 = _mm512_set1_pd(4503599627370496.0);
+    k.v = _mm512_sub_pd(_mm512_castsi512_pd(_mm512_or_si512(e, _mm512_castpd_si512(two52))),
+        _mm512_set1_pd(4503599627370496.0 + 1023));
+}
+#endif
+
+// log(1 + x) for finite x > -1, on every lane, after fdlibm's s_log1p.c (Sun Microsystems, 1993),
+// with the branches turned into selects. Maximum error below 1 ulp (fdlibm's bound; measured against
+// long double over (-1, 1e6) and tiny |x|: < 0.85 ulp). Close to 0 it works on x itself instead of
+// the rounded 1 + x, so log1p(-Q) has no cancellation where log(1 - Q) has for tiny Q.
+// The scalar instance gives exactly the same results as the vector lanes.
+template <typename vd>
+inline vd log1p(vd x)
+{
+    const double ln2_hi = 6.93147180369123816490e-01, ln2_lo = 1.90821492927058770002e-10,
+        Lp1 = 6.666666666666735130e-01, Lp2 = 3.999999999940941908e-01, Lp3 = 2.857142874366239149e-01,
+        Lp4 = 2.222219843214978396e-01, Lp5 = 1.818357216161805012e-01, Lp6 = 1.531383769920937332e-01,
+        Lp7 = 1.479819860511658591e-01;
+    const vd zero = vd(), u = 1 + x;
+    vd m, k;
+    split_sqrt2(u, m, k);
+    // rounding error of 1 + x, relative to u. Exact for u < 2 as x - (u - 1), above as 1 - (u - x).
+    vd c = select(greater(u, broadcast(1.9999999999999998, x)), 1 - (u - x), x - (u - 1)) / u;
+    vd f = m - 1;
+    // 1 + x in (sqrt(2)/2, sqrt(2)): k = 0, take f = x exactly.
+    const auto near0 = both(greater(x, broadcast(-0.29289321881345248, x)), greater(broadcast(0.41421356237309503, x), x));
+    f = select(near0, x, f);
+    k = select(near0, zero, k);
+    c = select(near0, zero, c);
+    const vd hfsq = 0.5 * f * f;
+    const vd s = f / (2 + f);
+    const vd z = s * s;
+    const vd R = z * (Lp1 + z * (Lp2 + z * (Lp3 + z * (Lp4 + z * (Lp5 + z * (Lp6 + z * Lp7))))));
+    return k * ln2_hi - ((hfsq - (s * (hfsq + R) + (k * ln2_lo + c))) - f);
+}
+
+// widest type available for this build.
+#if defined(__AVX512F__)
+using native = vd8;
+inline const char* isa() { return "avx512"; }
+#elif defined(__AVX2__)
+using native = vd4;
+inline const char* isa() { return "avx2"; }
+#else
+struct native { static constexpr size_t width = 1; };
+inline const char* isa() { return "scalar"; }
+#endif
+
+}
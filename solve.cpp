@@ -0,0 +1,376 @@
+// Solve mode, see solve.hpp.
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include "brent.hpp"
+#include "lander.hpp"
+#include "input.hpp"
+#include "batch.hpp"
+#include "threadpool.hpp"
+#include "solve.hpp"
+
+namespace lander {
+
+bool parse_template(const char* p, const char* end, SolveProblem& problem)
+{
+    problem.schedule.clear();
+    problem.free.clear();
+    for (;;)
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ',' || *p == '\r')) ++p;
+        if (p == end || *p == '#') return true;
+        if (*p == '?')
+        {   // ? or ?lo:hi
+            FreeRate f{ problem.schedule.size(), 8, 200, true };
+            if (++p < end && *p != ' ' && *p != '\t' && *p != ',')
+            {
+                p = parse_double(p, end, f.lo);
+                if (!p || p == end || *p != ':') return false;
+                p = parse_double(p + 1, end, f.hi);
+                if (!p || !(f.lo <= f.hi) || !valid_fuel_rate(f.lo) || !valid_fuel_rate(f.hi) || (f.lo == 0 && f.hi > 0))
+                    return false;
+                f.zero = false;
+            }
+            problem.free.push_back(f);
+            problem.schedule.push_back(f.zero ? 0 : f.lo);
+            continue;
+        }
+        double fr;
+        const char* next = parse_double(p, end, fr);
+        if (!next) return false;
+        problem.schedule.push_back(fr);
+        p = next;
+    }
+}
+
+// lands variations of a schedule, each from the snapshot of the turn that reads the first rate changed.
+class Evaluator {
+public:
+    Evaluator(const Options& opt, const SolveOptions& so) : opt(opt), so(so), simulate(simulator(opt.CalcMethod)) {}
+
+    void prepare(const Schedule& schedule)
+    {
+        base = schedule;
+        snapshots.clear();
+        lander::simulate(base, opt, snapshots);
+    }
+    // for operator(): the rate at index varies.
+    void prepare(const Schedule& schedule, size_t index)
+    {
+        prepare(schedule);
+        at = index;
+    }
+
+    // s is the prepared schedule with the rates from first on changed.
+    LandingResult land(const Schedule& s, size_t first)
+    {
+        ++evaluations;
+        const Snapshot* from = nullptr;
+        for (const Snapshot& snapshot : snapshots)
+            if (snapshot.next <= first) from = &snapshot; else break;
+        return from ? resimulate(*from, s, opt) : simulate(s, opt);
+    }
+    LandingResult operator()(double x)
+    {
+        static thread_local Schedule s;
+        s = base;
+        s[at] = x;
+        return land(s, at);
+    }
+
+    bool feasible(const LandingResult& r) const { return so.limit_mph < 0 || r.impact_mph() <= so.limit_mph; }
+    // what is minimized. Landings that break the limit cost more than the others, the faster the more.
+    double cost(const LandingResult& r) const
+    {
+        if (!feasible(r)) return 1e9 + r.impact_mph();
+        switch (so.cost)
+        {
+        case COST_IMPACT: return r.impact_mph();
+        case COST_FUEL: return -r.fuel;
+        case COST_TIME: return r.T;
+        default: return so.limit_mph < 0 ? r.impact_mph() : -r.fuel;
+        }
+    }
+
+    std::atomic<long> evaluations{ 0 };
+
+private:
+    const Options& opt;
+    const SolveOptions& so;
+    const simulate_fn simulate;
+    Schedule base;
+    size_t at{ 0 };
+    std::vector<Snapshot> snapshots;
+};
+
+// the best value of one free rate with the others fixed, starting from its current value.
+static double best_rate(const FreeRate& f, Schedule& schedule, Evaluator& eval, const SolveOptions& so, ThreadPool& pool)
+{
+    eval.prepare(schedule, f.index);
+    const unsigned n = so.grid < 2 ? 2 : so.grid;
+    const double step = (f.hi - f.lo) / (n - 1);
+    // the grid, then 0 and the current value as candidates as well.
+    std::vector<double> x(n), cost(n + 2);
+    for (unsigned i = 0; i < n; ++i) x[i] = i + 1 == n ? f.hi : f.lo + i * step;
+    x.push_back(f.zero ? 0 : f.lo);
+    x.push_back(schedule[f.index]);
+    pool.parallel_for(x.size(), 16, [&](size_t b, size_t e)
+    {
+        for (size_t i = b; i < e; ++i) cost[i] = eval.cost(eval(x[i]));
+    });
+    size_t best = x.size() - 1;
+    for (size_t i = 0; i < x.size(); ++i)
+        if (cost[i] < cost[best]) best = i;
+    double xbest = x[best], cbest = cost[best];
+    if (xbest == 0 || step == 0) return xbest;
+
+    auto consider = [&](double v)
+    {
+        const double cv = eval.cost(eval(v));
+        if (cv < cbest) { xbest = v; cbest = cv; }
+    };
+    // refine between the grid neighbours.
+    auto minimize = [&]()
+    {
+        const double a = xbest - step < f.lo ? f.lo : xbest - step, c = xbest + step > f.hi ? f.hi : xbest + step;
+        double v;
+        brent::local_min(a, c, so.tolerance, [&](double u) { return eval.cost(eval(u)); }, v);
+        consider(v);
+        // The minimum of the suicide burn is a cusp or a jump (a landing at the lowest point on one
+        // side, flying on to a harder one on the other), where local_min stops sqrt(eps) * |x| short.
+        // Searching the offset from v instead, its relative tolerance is taken of the offset.
+        const double x0 = xbest, d = 4 * (1.5e-8 * fabs(x0) + so.tolerance);
+        const double lo = x0 - d < f.lo ? f.lo - x0 : -d, hi = x0 + d > f.hi ? f.hi - x0 : d;
+        brent::local_min(lo, hi, so.tolerance, [&](double y) { return eval.cost(eval(x0 + y)); }, v);
+        consider(x0 + v);
+    };
+    if (!eval.feasible(eval(xbest)))
+    {   // no candidate keeps to the limit (the suicide burn falls between them): the softest landing
+        // around the best one first, the cost of the others is their impact velocity.
+        minimize();
+        if (!eval.feasible(eval(xbest))) return xbest;
+    }
+    const double x0 = xbest;
+    const double a = x0 - step < f.lo ? f.lo : x0 - step, c = x0 + step > f.hi ? f.hi : x0 + step;
+    const bool ends_feasible[2] = { eval.feasible(eval(a)), eval.feasible(eval(c)) };
+    if (ends_feasible[0] && ends_feasible[1])
+    {
+        minimize();
+        return xbest;
+    }
+    // a neighbour breaks the limit: the best landing is usually right at it. Find where the impact
+    // velocity crosses the limit and step back to the side that keeps to it.
+    for (int side = 0; side < 2; ++side)
+    {
+        const double e = side ? c : a;
+        if (ends_feasible[side] || e == x0) continue;
+        double v = brent::zero(x0, e, so.tolerance, [&](double u) { return eval(u).impact_mph() - so.limit_mph; });
+        double back = so.tolerance > 0 ? so.tolerance : 1e-12;
+        for (int k = 0; k < 64 && !eval.feasible(eval(v)); ++k, back *= 2)
+            v = fabs(x0 - v) <= back ? x0 : v + (x0 > v ? back : -back);
+        consider(v);
+    }
+    return xbest;
+}
+
+SolveResult solve(const SolveProblem& problem, const Options& opt, const SolveOptions& so, ThreadPool& pool)
+{
+    Evaluator eval(opt, so);
+    SolveResult result;
+    result.schedule = problem.schedule;
+    double cost = eval.cost(simulate(result.schedule, opt));
+    for (int round = 0; round < so.rounds && !problem.free.empty(); ++round)
+    {   // one free rate after the other, until a round gains nothing.
+        const double before = cost;
+        for (const FreeRate& f : problem.free)
+            result.schedule[f.index] = best_rate(f, result.schedule, eval, so, pool);
+        cost = eval.cost(simulate(result.schedule, opt));
+        if (problem.free.size() == 1 || !(cost < before - 1e-12 * (1 + fabs(before)))) break;
+    }
+    result.landing = simulate(result.schedule, opt);
+    result.evaluations = eval.evaluations + 1;
+    result.feasible = eval.feasible(result.landing);
+    return result;
+}
+
+int solve_main(const char* path, const Options& opt, unsigned nthreads, const SolveOptions& so)
+{
+    FILE* in = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+    if (!in) { fprintf(stderr, "Cannot open template file %s\n", path); return 1; }
+    std::vector<SolveProblem> problems;
+    {
+        LineReader lines(in);
+        size_t length;
+        SolveProblem problem;
+        for (const char* line; (line = lines.next(&length)) != nullptr;)
+        {
+            ++problem.line;
+            if (!parse_template(line, line + length, problem))
+                fprintf(stderr, "template line %d: not a fuel rate schedule, skipped\n", problem.line);
+            else if (!problem.schedule.empty())
+                problems.push_back(problem);
+        }
+    }
+    if (in != stdin) fclose(in);
+
+    ThreadPool pool(nthreads);
+    fputs("line,time,impact_mph,fuel_left,landing,calc,fuel_out_time,within_limit,evaluations,free_rates\n", stdout);
+    for (const SolveProblem& problem : problems)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const SolveResult r = solve(problem, opt, so, pool);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        const LandingResult& l = r.landing;
+        printf("%d,%.17g,%.17g,%.17g,%s,%s,%.17g,%d,%ld,", problem.line, l.T, l.impact_mph(), l.fuel,
+            landingclass_name(classify(l.impact_mph())), calcmethod_name(l.method), l.fuel_out_T, (int)r.feasible,
+            r.evaluations);
+        for (size_t i = 0; i < problem.free.size(); ++i)
+            printf(i ? " %.17g" : "%.17g", r.schedule[problem.free[i].index]);
+        putchar('\n');
+        fprintf(stderr, "solve line %d: %ld landings in %.1f ms\n", problem.line, r.evaluations, ms);
+    }
+    return 0;
+}
+
+
+// 0 or 8 to 200, the nearer of the two for the rates in between.
+static double allowed_rate(double fr)
+{
+    if (!(fr >= 4)) return 0;
+    if (fr < 8) return 8;
+    return fr > 200 ? 200 : fr;
+}
+
+// y = x + alpha * d, with allowed rates.
+static void move(const Schedule& x, const Schedule& d, double alpha, Schedule& y)
+{
+    y.resize(x.size());
+    for (size_t i = 0; i < x.size(); ++i) y[i] = d[i] ? allowed_rate(x[i] + alpha * d[i]) : x[i];
+}
+
+struct LineSearch {
+    double alpha, cost;
+};
+
+// the best step along d from x: a few candidates over the steps that keep all rates in [0, 200],
+// then brent::local_min between the neighbours of the best one.
+static LineSearch line_search(const Schedule& x, const Schedule& d, double fx, Evaluator& eval, const SolveOptions& so)
+{
+    LineSearch best{ 0, fx };
+    size_t first = 0;
+    while (first < d.size() && d[first] == 0) ++first;
+    double lo = -HUGE_VAL, hi = HUGE_VAL;
+    for (size_t i = first; i < d.size(); ++i)
+        if (d[i] != 0)
+        {
+            const double a = -x[i] / d[i], b = (200 - x[i]) / d[i];
+            lo = std::max(lo, std::min(a, b));
+            hi = std::min(hi, std::max(a, b));
+        }
+    if (first == d.size() || !(hi > lo)) return best;
+    Schedule y;
+    auto cost = [&](double alpha) { move(x, d, alpha, y); return eval.cost(eval.land(y, first)); };
+    const int n = 16;
+    const double h = (hi - lo) / n;
+    for (int i = 0; i <= n; ++i)
+    {
+        const double alpha = i == n ? hi : lo + i * h, c = cost(alpha);
+        if (c < best.cost) best = LineSearch{ alpha, c };
+    }
+    double alpha;
+    const double c = brent::local_min(std::max(lo, best.alpha - h), std::min(hi, best.alpha + h), so.tolerance, cost, alpha);
+    if (c < best.cost) best = LineSearch{ alpha, c };
+    return best;
+}
+
+SolveResult optimize(const Schedule& start, const Options& opt, const SolveOptions& so, ThreadPool& pool)
+{
+    Evaluator eval(opt, so);
+    SolveResult result;
+    Schedule& x = result.schedule;
+    for (double fr : start) x.push_back(allowed_rate(fr));
+    if (x.empty()) x.push_back(0);
+    LandingResult r = simulate(x, opt);
+    double fx = eval.cost(r);
+    std::vector<Schedule> directions;
+    Schedule y, z;
+    for (int sweep = 0; sweep < so.sweeps; ++sweep)
+    {   // a rate for every turn of the landing, at first a direction per turn.
+        while (x.size() < (size_t)r.turns) x.push_back(x.back());
+        for (size_t i = directions.size(); i < x.size(); ++i)
+        {
+            directions.emplace_back(x.size(), 0.0);
+            directions.back()[i] = 1;
+        }
+        for (Schedule& d : directions) d.resize(x.size(), 0.0);
+
+        // the line searches along all directions from x at the same time.
+        eval.prepare(x);
+        std::vector<LineSearch> moves(directions.size(), LineSearch{ 0, fx });
+        pool.parallel_for(directions.size(), 1, [&](size_t b, size_t e)
+        {
+            for (size_t k = b; k < e; ++k) moves[k] = line_search(x, directions[k], fx, eval, so);
+        });
+        std::vector<size_t> order;
+        for (size_t k = 0; k < moves.size(); ++k)
+            if (moves[k].cost < fx) order.push_back(k);
+        if (order.empty()) break;
+        std::sort(order.begin(), order.end(), [&](size_t i, size_t j) { return moves[i].cost < moves[j].cost; });
+
+        // the best move, then the others on top of it as long as they still gain.
+        move(x, directions[order[0]], moves[order[0]].alpha, y);
+        double fy = moves[order[0]].cost;
+        for (size_t j = 1; j < order.size(); ++j)
+        {
+            move(y, directions[order[j]], moves[order[j]].alpha, z);
+            size_t first = 0;
+            while (first < z.size() && z[first] == x[first]) ++first;
+            const double c = eval.cost(eval.land(z, first));
+            if (c < fy) { y.swap(z); fy = c; }
+        }
+        if (!(fy < fx - 1e-12 * (1 + fabs(fx)))) break;
+        // Powell: the move of the whole sweep replaces the direction that gained most.
+        for (size_t i = 0; i < x.size(); ++i) directions[order[0]][i] = y[i] - x[i];
+        x.swap(y);
+        fx = fy;
+        r = simulate(x, opt);
+    }
+    result.landing = simulate(x, opt);
+    result.evaluations = eval.evaluations + 1;
+    result.feasible = eval.feasible(result.landing);
+    return result;
+}
+
+int optimize_main(const char* path, const Options& opt, unsigned nthreads, const SolveOptions& so)
+{
+    FILE* in = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+    if (!in) { fprintf(stderr, "Cannot open batch file %s\n", path); return 1; }
+    std::vector<BatchEntry> entries;
+    const bool ok = read_batch(in, entries);
+    if (in != stdin) fclose(in);
+    if (!ok) { fprintf(stderr, "Cannot read batch file %s\n", path); return 1; }
+
+    ThreadPool pool(nthreads);
+    fputs("line,time,impact_mph,fuel_left,landing,calc,fuel_out_time,within_limit,evaluations,schedule\n", stdout);
+    for (const BatchEntry& entry : entries)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const SolveResult r = optimize(entry.schedule, opt, so, pool);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        const LandingResult& l = r.landing;
+        printf("%d,%.17g,%.17g,%.17g,%s,%s,%.17g,%d,%ld,", entry.line, l.T, l.impact_mph(), l.fuel,
+            landingclass_name(classify(l.impact_mph())), calcmethod_name(l.method), l.fuel_out_T, (int)r.feasible,
+            r.evaluations);
+        for (int i = 0; i < l.turns && i < (int)r.schedule.size(); ++i)
+            printf(i ? " %.17g" : "%.17g", r.schedule[i]);
+        putchar('\n');
+        fprintf(stderr, "optimize line %d: %ld landings in %.1f ms\n", entry.line, r.evaluations, ms);
+    }
+    return 0;
+}
+
+}
@@ -0,0 +1,70 @@
+// Solve mode (--solve <file>): finds the fuel rates of the free turns of a schedule template, as the
+// suicide burns of inputsuicideburns.txt were found by hand. One template per line, as a batch file,
+// with ? for a free rate (anywhere in 0 or 8 to 200 lbs/sec) or ?lo:hi for a free rate in [lo, hi]:
+//    0 0 0 0 0 0 0 ? 200 200 200 200 200 200 200
+// Minimizes the impact velocity, or with --limit <mph> maximizes the fuel left of the landings
+// that touch down at most that fast.
+// Each free rate is searched on a grid of candidates, landed in parallel, and the best one refined
+// with brent::local_min, or brent::zero to the speed limit when a neighbour breaks it; several free
+// rates are refined in turn, round after round. Candidates are landed from the snapshot of the turn
+// before the rate, not from T = 0.
+// Optimize mode (--optimize <file>): every rate of each schedule in a batch file is free. Powell's
+// method with brent::local_min as the line search, the line searches of a sweep in parallel.
+// --cost impact|fuel|time picks what is minimized; with fuel or time, give a --limit as well.
+#pragma once
+#include <stddef.h>
+#include <vector>
+#include "lander.hpp"
+
+namespace lander {
+
+class ThreadPool;
+
+struct FreeRate {
+    size_t index;               // in the schedule
+    double lo, hi;              // bounds of the search
+    bool zero;                  // 0 is a candidate too (a plain ?)
+};
+
+struct SolveProblem {
+    int line{ 0 };
+    Schedule schedule;          // the free rates hold the current values
+    std::vector<FreeRate> free;
+};
+
+// COST_AUTO is the impact velocity without a limit and the fuel used with one.
+enum solvecost { COST_AUTO, COST_IMPACT, COST_FUEL, COST_TIME };
+
+struct SolveOptions {
+    double limit_mph{ -1 };     // < 0: no limit; landings faster than it cost more than any other
+    solvecost cost{ COST_AUTO };
+    unsigned grid{ 1024 };      // candidates per free rate
+    double tolerance{ 1e-10 };  // lbs/sec, of the refinement
+    int rounds{ 8 };            // at most, with more than one free rate
+    int sweeps{ 40 };           // at most, of optimize()
+};
+
+struct SolveResult {
+    Schedule schedule;
+    LandingResult landing;
+    long evaluations{ 0 };      // landings flown
+    bool feasible{ true };      // with a limit: the landing keeps to it
+};
+
+// one template line, see above. Returns false if it holds anything else.
+bool parse_template(const char* p, const char* end, SolveProblem& problem);
+
+SolveResult solve(const SolveProblem& problem, const Options& opt, const SolveOptions& so, ThreadPool& pool);
+
+// --solve front end: a csv row per template with the landing and the free rates found.
+int solve_main(const char* path, const Options& opt, unsigned nthreads, const SolveOptions& so);
+
+// the rate of every turn up to the landing, starting from start. Rates are kept to 0 or 8 to 200:
+// below 4 to 0, below 8 to 8, above 200 to 200. The schedule is extended with its last rate to the
+// turns the landing takes.
+SolveResult optimize(const Schedule& start, const Options& opt, const SolveOptions& so, ThreadPool& pool);
+
+// --optimize front end: a csv row per schedule with the landing and the whole schedule found.
+int optimize_main(const char* path, const Options& opt, unsigned nthreads, const SolveOptions& so);
+
+}
@@ -0,0 +1,43 @@
+// Hot path counters, see stats.hpp.
+#include <stdio.h>
+#include "stats.hpp"
+
+namespace lander {
+
+#ifdef LANDER_STATS
+thread_local Stats stats;
+#endif
+
+Stats& Stats::operator+=(const Stats& s)
+{
+    apply_thrust += s.apply_thrust;
+    update_lander_state += s.update_lander_state;
+    lowest_point_loops += s.lowest_point_loops;
+    moon_loops += s.moon_loops;
+    solver_evaluations += s.solver_evaluations;
+    zero_evaluations += s.zero_evaluations;
+    quadratic_fallbacks += s.quadratic_fallbacks;
+    return *this;
+}
+
+void write_stats(FILE* out, const Stats& s, statsformat format)
+{
+    if (format == STATS_JSON)
+        fprintf(out, "{\"apply_thrust\": %ld, \"update_lander_state\": %ld, \"lowest_point_loops\": %ld, "
+            "\"moon_loops\": %ld, \"solver_evaluations\": %ld, \"zero_evaluations\": %ld, \"quadratic_fallbacks\": %ld}\n",
+            s.apply_thrust, s.update_lander_state, s.lowest_point_loops, s.moon_loops, s.solver_evaluations,
+            s.zero_evaluations, s.quadratic_fallbacks);
+    else if (format == STATS_BLOCK)
+        fprintf(out, "STATS\n"
+            "  APPLY_THRUST CALLS          %10ld\n"
+            "  UPDATE_LANDER_STATE CALLS   %10ld\n"
+            "  08.10 LOWEST POINT LOOPS    %10ld\n"
+            "  07.10 ON THE MOON LOOPS     %10ld\n"
+            "  LOWEST POINT EVALUATIONS    %10ld\n"
+            "    BY BRENT::ZERO            %10ld\n"
+            "  QUADRATIC() FALLBACKS       %10ld\n",
+            s.apply_thrust, s.update_lander_state, s.lowest_point_loops, s.moon_loops, s.solver_evaluations,
+            s.zero_evaluations, s.quadratic_fallbacks);
+}
+
+}
@@ -0,0 +1,38 @@
+// Hot path counters of the turn engine, opt-in: compile with LANDER_STATS defined
+// (/D LANDER_STATS, -DLANDER_STATS) and run with --stats to see per landing where the time goes,
+// the speed reversal search (08.10) or the surface contact refinement (07.10).
+// Without LANDER_STATS the counting macros are empty and LandingResult carries no counters.
+#pragma once
+#include <stdio.h>
+
+namespace lander {
+
+struct Stats {
+    long apply_thrust{ 0 };         // apply_thrust() calls
+    long update_lander_state{ 0 };  // update_lander_state() calls
+    long lowest_point_loops{ 0 };   // passes of the 08.10 speed reversal loop (il81)
+    long moon_loops{ 0 };           // passes of the 07.10 loop_until_on_the_moon loop
+    long solver_evaluations{ 0 };   // getspeed() calls of lowest_point_time() (exact method)
+    long zero_evaluations{ 0 };     // of which by its brent::zero fall back
+    long quadratic_fallbacks{ 0 };  // 07.10 exact: quadratic() found no real root, the closed form TF is kept
+    Stats& operator+=(const Stats& s);
+};
+
+enum statsformat { STATS_OFF, STATS_BLOCK, STATS_JSON };
+
+// the counters as a block of lines, or as one line of json.
+void write_stats(FILE* out, const Stats& s, statsformat format);
+
+#ifdef LANDER_STATS
+constexpr bool stats_compiled_in = true;
+// counters of the landing in progress on this thread, reset by simulate() and the game.
+extern thread_local Stats stats;
+ #define LANDER_COUNT(counter) (++lander::stats.counter)
+ #define LANDER_ADD(counter, n) (lander::stats.counter += (n))
+#else
+constexpr bool stats_compiled_in = false;
+ #define LANDER_COUNT(counter) ((void)0)
+ #define LANDER_ADD(counter, n) ((void)0)
+#endif
+
+}
@@ -0,0 +1,105 @@
+// Work-stealing thread pool, see threadpool.hpp.
+#include "threadpool.hpp"
+
+namespace lander {
+
+// pool and queue of the current thread, if it is a pool worker.
+static thread_local ThreadPool* current_pool = nullptr;
+static thread_local size_t current_queue = 0;
+
+ThreadPool::ThreadPool(unsigned nthreads)
+{
+    if (nthreads == 0) nthreads = std::thread::hardware_concurrency();
+    if (nthreads == 0) nthreads = 1;
+    for (unsigned i = 0; i < nthreads; ++i) queues.emplace_back(new Queue);
+    for (unsigned i = 0; i < nthreads; ++i) threads.emplace_back(&ThreadPool::work, this, (size_t)i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : threads) t.join();
+}
+
+unsigned ThreadPool::worker_index() const
+{
+    return current_pool == this ? (unsigned)current_queue : size();
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    const size_t q = current_pool == this ? current_queue : next_queue++ % queues.size();
+    {
+        std::lock_guard<std::mutex> guard(queues[q]->lock);
+        queues[q]->tasks.push_back(std::move(task));
+    }
+    {   // taking the lock avoids a lost wakeup between a worker's check of queued and its wait.
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        ++queued;
+    }
+    wake.notify_one();
+}
+
+bool ThreadPool::try_take(size_t self, std::function<void()>& task)
+{
+    const size_t n = queues.size();
+    {   // own work first, newest first (still hot in cache)
+        Queue& own = *queues[self % n];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            --queued;
+            return true;
+        }
+    }
+    for (size_t i = 1; i < n; ++i)
+    {   // steal the oldest task of another worker
+        Queue& victim = *queues[(self + i) % n];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --queued;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::work(size_t self)
+{
+    current_pool = this;
+    current_queue = self;
+    std::function<void()> task;
+    for (;;)
+    {
+        if (try_take(self, task))
+        {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(sleep_lock);
+        wake.wait(guard, [this]() { return stopping || queued > 0; });
+        if (stopping && queued == 0) return;
+    }
+}
+
+void ThreadPool::help_until_zero(const std::atomic<size_t>& remaining)
+{
+    const size_t self = current_pool == this ? current_queue : 0;
+    std::function<void()> task;
+    while (remaining > 0)
+    {
+        if (try_take(self, task)) task();
+        else std::this_thread::yield();     // the last tasks are running elsewhere
+    }
+}
+
+}
@@ -0,0 +1,66 @@
+// Small work-stealing thread pool, used to land many schedules at the same time.
+// Each worker has its own deque of tasks: it takes work from the back of its own deque
+// and steals from the front of the others when it runs dry.
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lander {
+
+class ThreadPool {
+public:
+    // nthreads == 0 means one worker per hardware thread.
+    explicit ThreadPool(unsigned nthreads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return (unsigned)threads.size(); }
+    // index of the calling thread among the workers, size() for any other thread.
+    // Lets tasks use per-thread data without locking.
+    unsigned worker_index() const;
+    // queue a task. From inside a worker it goes to that worker's own deque, otherwise round robin.
+    void submit(std::function<void()> task);
+    // run queued tasks on the calling thread as well until remaining drops to zero.
+    void help_until_zero(const std::atomic<size_t>& remaining);
+
+    // call f(begin, end) for consecutive ranges of at most grain indices covering [0, n),
+    // and return when all of them are done. May be called from inside a task.
+    template <typename F>
+    void parallel_for(size_t n, size_t grain, F&& f)
+    {
+        if (n == 0) return;
+        if (grain == 0) grain = 1;
+        std::atomic<size_t> remaining{ (n + grain - 1) / grain };
+        for (size_t b = 0; b < n; b += grain)
+        {
+            const size_t e = b + grain < n ? b + grain : n;
+            submit([&f, &remaining, b, e]() { f(b, e); --remaining; });
+        }
+        help_until_zero(remaining);
+    }
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex sleep_lock;
+    std::condition_variable wake;
+    std::atomic<size_t> queued{ 0 };
+    std::atomic<unsigned> next_queue{ 0 };
+    bool stopping{ false };
+
+    bool try_take(size_t self, std::function<void()>& task);
+    void work(size_t self);
+};
+
+}
@@ -0,0 +1,109 @@
+// Prints a trajectory file (lunarlander --trajectory <file>, see trajectory.hpp) as the game's table:
+// the turn rows with the fuel rate that was accepted, the sub-step and lowest point rows and the
+// landing report, per landing. --info prints the header and the counts only.
+// Not part of the game, build it on its own:
+//    cl /O2 /EHsc trajdump.cpp trajectory.cpp output.cpp lander.cpp brent.cpp
+//    g++ -std=c++17 -O2 trajdump.cpp trajectory.cpp output.cpp lander.cpp brent.cpp -o trajdump
+// usage: trajdump [--info] [--landing <n>] <file>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lander.hpp"
+#include "output.hpp"
+#include "trajectory.hpp"
+
+static lander::Output out(stdout);
+
+static void report(const lander::TrajectoryRecord& r, const char* calcmess)
+{   // the lines of 05.10 to 05.83, as the game prints them.
+    const double X = 3600 * r.V;
+    out.text("\nON THE MOON AT   ").fixed(r.T, 8, 3).line(" SECS");
+    out.text("IMPACT VELOCITY: ").fixed(X, 8, 3).line(" M.P.H.");
+    out.text("FUEL LEFT:       ").fixed(r.fuel, 8, 2).line(" LBS");
+    switch (lander::classify(X))
+    {
+    case lander::PERFECT: out.line("PERFECT LANDING !-(LUCKY)"); break;
+    case lander::GOOD: out.line("GOOD LANDING-(COULD BE BETTER)"); break;
+    case lander::POOR: out.line("CONGRATULATIONS ON A POOR LANDING"); break;
+    case lander::DAMAGE: out.line("CRAFT DAMAGE. GOOD LUCK"); break;
+    case lander::CRASH: out.line("CRASH LANDING-YOU'VE 5 HRS OXYGEN"); break;
+    default:
+        out.line("SORRY,BUT THERE WERE NO SURVIVORS-YOU BLEW IT!");
+        out.text("IN FACT YOU BLASTED A BUGFIXED LUNAR CRATER ").fixed(X * .277777, 8, 2).line(" FT. DEEP");
+    }
+    out.text("(Calculated using the ").text(calcmess).line(" version for time to lowest point (zero speed))");
+}
+
+static void row(const lander::TrajectoryRecord& r)
+{
+    const double feet = 5280 * (r.A - trunc(r.A));
+    switch (r.kind)
+    {
+    case lander::TRAJ_TURN:
+        out.fixed(r.T, 7, 0).fixed(trunc(r.A), 16, 0).fixed(feet, 7, 0).fixed(3600 * r.V, 15, 2)
+            .fixed(r.fuel, 12, 1).text("      FR:=").shortest(r.FR).put('\n');
+        break;
+    case lander::TRAJ_SUBSTEP:
+        out.fixed(r.T, 11, 3).fixed(trunc(r.A), 12, 0).fixed(feet, 7, 0, true).fixed(3600 * r.V, 15, 2)
+            .fixed(r.fuel, 12, 1).text("      FR  ").fixed(r.FR, 0, 6).put('\n');
+        break;
+    case lander::TRAJ_LOWEST_POINT:
+        out.fixed(r.T, 11, 3).fixed(trunc(r.A), 12, 0).fixed(feet, 7, 1, true).fixed(3600 * r.V, 15, 2)
+            .fixed(r.fuel, 12, 1).text("      FR  ").fixed(r.FR, 0, 6).put('\n');
+        break;
+    case lander::TRAJ_FUEL_OUT:
+        out.text("\nFUEL OUT AT ").fixed(r.T, 8, 2).line(" SECS");
+        break;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const char* path = nullptr;
+    bool info = false;
+    long only = -1;
+    for (int ia = 1; ia < argc; ++ia)
+    {
+        if (!strcmp(argv[ia], "--info")) info = true;
+        else if (!strcmp(argv[ia], "--landing") && ia + 1 < argc) only = atol(argv[++ia]);
+        else if (argv[ia][0] != '-' && !path) path = argv[ia];
+        else
+        {
+            fprintf(stderr, "usage: %s [--info] [--landing <n>] <file>\n", argv[0]);
+            return 1;
+        }
+    }
+    if (!path) { fprintf(stderr, "usage: %s [--info] [--landing <n>] <file>\n", argv[0]); return 1; }
+    lander::TrajectoryFile file;
+    if (!file.open(path)) { fprintf(stderr, "%s: %s\n", path, file.error()); return 1; }
+    const lander::TrajectoryHeader& h = file.header();
+    const char* calcmess = lander::calcmethod_name((lander::calcmethod)h.method);
+    if (info)
+    {
+        printf("version %u, %s, max drop height %g ft\n", h.version, calcmess, h.maxdropheightft);
+        printf("A %g mi, V %g mi/s, M %g lbs, empty %g lbs, G %g, thrust %g\n", h.A, h.V, h.M, h.EmptyMass, h.G,
+            h.SpecThrust);
+        printf("%llu landings, %zu records", (unsigned long long)h.landings, file.size());
+        if (h.records != file.size()) printf(" (header: %llu, not closed)", (unsigned long long)h.records);
+        printf("\n");
+        return 0;
+    }
+    const lander::TrajectoryRecord* r = file.records();
+    long landing = -1;
+    for (size_t i = 0; i < file.size(); ++i)
+    {
+        if (only >= 0 && r[i].landing != (uint32_t)only) continue;
+        if ((long)r[i].landing != landing)
+        {   // 01.20 to 01.40
+            landing = r[i].landing;
+            out.line("FIRST RADAR CHECK COMING UP\n\n");
+            out.line("COMMENCE LANDING PROCEDURE");
+            out.line("TIME,SECS   ALTITUDE,MILES+FEET   VELOCITY,MPH   FUEL,LBS   FUEL RATE");
+        }
+        if (r[i].kind == lander::TRAJ_ON_THE_MOON) { report(r[i], calcmess); out.put('\n'); }
+        else row(r[i]);
+    }
+    out.flush();
+    return 0;
+}
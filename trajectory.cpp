@@ -0,0 +1,136 @@
+// Binary trajectories, see trajectory.hpp.
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+ #include <Windows.h>
+#else
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+#include "lander.hpp"
+#include "trajectory.hpp"
+
+namespace lander {
+
+static const char trajectory_magic[8] = { 'L', 'A', 'N', 'D', 'T', 'R', 'A', 'J' };
+
+bool TrajectoryWriter::open(const char* path, const Options& opt)
+{
+    close();
+    out = fopen(path, "wb");
+    if (!out) return false;
+    setvbuf(out, nullptr, _IOFBF, 1 << 20);
+    const LanderState L;
+    header = TrajectoryHeader{};
+    memcpy(header.magic, trajectory_magic, sizeof(header.magic));
+    header.version = trajectory_version;
+    header.header_size = sizeof(TrajectoryHeader);
+    header.record_size = sizeof(TrajectoryRecord);
+    header.method = opt.CalcMethod;
+    header.maxdropheightft = opt.maxdropheightft;
+    header.A = L.A; header.V = L.V; header.M = L.M;
+    header.EmptyMass = L.EmptyMass; header.G = L.G; header.SpecThrust = L.SpecThrust;
+    landing = 0;
+    turn = 0;
+    return fwrite(&header, sizeof(header), 1, out) == 1;
+}
+
+void TrajectoryWriter::close()
+{
+    if (!out) return;
+    header.landings = landing;
+    if (fseek(out, 0, SEEK_SET) == 0) fwrite(&header, sizeof(header), 1, out);
+    fclose(out);
+    out = nullptr;
+}
+
+void TrajectoryWriter::write(const LanderState& L, double V, double fr, trajectorykind kind)
+{
+    if (!out) return;
+    TrajectoryRecord r;
+    r.T = L.T;
+    r.A = L.A;
+    r.V = V;
+    r.fuel = L.fuel();
+    r.FR = fr;
+    r.landing = landing;
+    r.turn = turn;
+    r.kind = kind;
+    r.reserved = 0;
+    fwrite(&r, sizeof(r), 1, out);
+    ++header.records;
+}
+
+void TrajectoryWriter::start_turn(const LanderState& L, double fr)
+{
+    ++turn;
+    write(L, L.V, fr, TRAJ_TURN);
+}
+
+void TrajectoryWriter::rows(const std::vector<TrajectoryRecord>& rows)
+{
+    if (!out) return;
+    for (TrajectoryRecord r : rows)
+    {
+        if (r.kind == TRAJ_TURN) continue;
+        r.landing = landing;
+        r.turn = turn;
+        fwrite(&r, sizeof(r), 1, out);
+        ++header.records;
+        if (r.kind == TRAJ_ON_THE_MOON) { ++landing; turn = 0; }
+    }
+}
+
+bool TrajectoryFile::open(const char* path)
+{
+    close();
+#ifdef _WIN32
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) { file = nullptr; message = "cannot open"; return false; }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) { message = "cannot get the size"; close(); return false; }
+    bytes = (size_t)size.QuadPart;
+    if (bytes < sizeof(TrajectoryHeader)) { message = "too short for a header"; close(); return false; }
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) { message = "cannot map"; close(); return false; }
+    data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    const int fd = ::open(path, O_RDONLY);
+    if (fd < 0) { message = "cannot open"; return false; }
+    struct stat st;
+    if (fstat(fd, &st) != 0) { message = "cannot get the size"; ::close(fd); return false; }
+    bytes = (size_t)st.st_size;
+    if (bytes < sizeof(TrajectoryHeader)) { message = "too short for a header"; ::close(fd); return false; }
+    void* p = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    data = p == MAP_FAILED ? nullptr : p;
+    if (data) madvise(p, bytes, MADV_SEQUENTIAL);
+#endif
+    if (!data) { message = "cannot map"; close(); return false; }
+    const TrajectoryHeader& h = header();
+    if (memcmp(h.magic, trajectory_magic, sizeof(h.magic))) { message = "not a trajectory file"; close(); return false; }
+    if (h.version != trajectory_version || h.record_size != sizeof(TrajectoryRecord)
+        || h.header_size < sizeof(TrajectoryHeader) || h.header_size % alignof(TrajectoryRecord) || h.header_size > bytes)
+    { message = "unknown trajectory version"; close(); return false; }
+    count = (bytes - h.header_size) / sizeof(TrajectoryRecord);
+    message = "";
+    return true;
+}
+
+void TrajectoryFile::close()
+{
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mapping) CloseHandle(mapping);
+    if (file) CloseHandle(file);
+    mapping = file = nullptr;
+#else
+    if (data) munmap(const_cast<void*>(data), bytes);
+#endif
+    data = nullptr;
+    bytes = count = 0;
+}
+
+}
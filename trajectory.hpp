@@ -0,0 +1,109 @@
+// Binary trajectories (--trajectory <file>): every row of the game's table, the start of each turn,
+// the il31 sub-steps and the lowest point of a speed reversal, as a fixed size record, after a header
+// with the calc method and the initial conditions. Analysis tools map the file and read the records
+// in place instead of parsing the text columns; trajdump.cpp turns it back into the table.
+// The layout is that of the writing machine (little endian doubles on all our platforms).
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <type_traits>
+#include <vector>
+#include "lander.hpp"
+
+namespace lander {
+
+enum trajectorykind : uint8_t {
+    TRAJ_TURN,          // start of a turn (02.10), FR is the rate accepted for it
+    TRAJ_SUBSTEP,       // extra pass of the 03.10 loop
+    TRAJ_LOWEST_POINT,  // landing at the lowest point, V is the speed there (EndSpeed)
+    TRAJ_FUEL_OUT,      // fuel ran out (04.10)
+    TRAJ_ON_THE_MOON    // touchdown (05.10), V is the impact velocity
+};
+
+struct TrajectoryHeader {
+    char magic[8];              // "LANDTRAJ"
+    uint32_t version;
+    uint32_t header_size;       // the records start here
+    uint32_t record_size;
+    int32_t method;             // calcmethod
+    double maxdropheightft;
+    double A, V, M, EmptyMass, G, SpecThrust;   // initial lander state
+    uint64_t landings;          // written when the file is closed, 0 if it was not
+    uint64_t records;
+};
+
+// a row of the table, with the values it prints unrounded.
+struct TrajectoryRecord {
+    double T;                   // s
+    double A;                   // mi
+    double V;                   // mi/s, downward
+    double fuel;                // lbs
+    double FR;                  // lbs/s
+    uint32_t landing;           // from 0, in the order of the games
+    uint16_t turn;              // from 1
+    uint8_t kind;               // trajectorykind
+    uint8_t reserved;
+};
+static_assert(sizeof(TrajectoryRecord) == 48, "records are read in place, keep the layout");
+static_assert(sizeof(TrajectoryHeader) % alignof(TrajectoryRecord) == 0, "records must stay aligned");
+static_assert(std::is_trivially_copyable<TrajectoryRecord>::value, "records are written as bytes");
+
+const uint32_t trajectory_version = 1;
+
+// Writes the records of the game's landings, from the rows of its session (session.hpp).
+class TrajectoryWriter {
+public:
+    TrajectoryWriter() = default;
+    TrajectoryWriter(const TrajectoryWriter&) = delete;
+    TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+    ~TrajectoryWriter() { close(); }
+
+    bool open(const char* path, const Options& opt);
+    void close();           // completes the header
+    bool is_open() const { return out != nullptr; }
+
+    // the game calls start_turn() with the rate accepted at the prompt, and rows() with the rows the
+    // session hands out after it; their turn rows are left to start_turn(), which has the rate of
+    // the turn. Each landing ends with its TRAJ_ON_THE_MOON row.
+    void start_turn(const LanderState& L, double fr);
+    void rows(const std::vector<TrajectoryRecord>& rows);
+
+private:
+    FILE* out{ nullptr };
+    TrajectoryHeader header{};
+    uint32_t landing{ 0 };
+    uint16_t turn{ 0 };
+    void write(const LanderState& L, double V, double fr, trajectorykind kind);
+};
+
+// A trajectory file mapped into memory, read only. The records are those of the file size,
+// also when the writer did not complete the header.
+class TrajectoryFile {
+public:
+    TrajectoryFile() = default;
+    TrajectoryFile(const TrajectoryFile&) = delete;
+    TrajectoryFile& operator=(const TrajectoryFile&) = delete;
+    ~TrajectoryFile() { close(); }
+
+    // false with a message in error() if the file cannot be mapped or is no trajectory file.
+    bool open(const char* path);
+    void close();
+    const char* error() const { return message; }
+
+    const TrajectoryHeader& header() const { return *reinterpret_cast<const TrajectoryHeader*>(data); }
+    const TrajectoryRecord* records() const
+    { return reinterpret_cast<const TrajectoryRecord*>(static_cast<const char*>(data) + header().header_size); }
+    size_t size() const { return count; }   // number of records
+
+private:
+    const void* data{ nullptr };
+    size_t bytes{ 0 }, count{ 0 };
+    const char* message{ "" };
+#ifdef _WIN32
+    void* file{ nullptr };
+    void* mapping{ nullptr };
+#endif
+};
+
+}